@@ -67,6 +67,9 @@ let thumbnailCache = new Map();
 let cacheAccessMap = new Map();
 let cacheAccessCounter = 0;
 let cacheDir = null;
+let previewIndexDir = null;
+let libraryRoots = new Set();
+let thumbnailPackDir = null;
 let ratingQueue = [];
 let isProcessingRatingQueue = false;
 let metadataCache = new Map();
@@ -82,6 +85,50 @@ function getCacheDir() {
   return cacheDir;
 }
 
+// 登记渲染进程打开的图库根目录（扫描的目录），预览索引按根目录划分
+function registerLibraryRoots(directories) {
+  for (const dir of directories || []) {
+    if (dir) libraryRoots.add(path.resolve(dir));
+  }
+}
+
+// 文件所属的图库根：已登记的根目录中包含它的最深一个；都不包含时退回文件所在目录
+function findLibraryRoot(filePath) {
+  const resolved = path.resolve(filePath);
+  let best = null;
+  for (const root of libraryRoots) {
+    const rel = path.relative(root, resolved);
+    if (rel && !rel.startsWith('..') && !path.isAbsolute(rel) && (!best || root.length > best.length)) {
+      best = root;
+    }
+  }
+  return best || path.dirname(resolved);
+}
+
+// RAW 预览偏移索引：每个图库根一个文件，再次打开时提取预览只需一次定点读取。
+// root 省略时按 findLibraryRoot 推断
+function getPreviewIndexPath(filePath, root) {
+  if (!previewIndexDir) {
+    previewIndexDir = path.join(app.getPath('home'), '.photo_manager', 'preview_index');
+    if (!fs.existsSync(previewIndexDir)) {
+      fs.mkdirSync(previewIndexDir, { recursive: true });
+    }
+  }
+  const key = root ? path.resolve(root) : findLibraryRoot(filePath);
+  return path.join(previewIndexDir, crypto.createHash('md5').update(key).digest('hex') + '.qpi');
+}
+
+// native 缩略图磁盘缓存目录：pack 文件 + 索引，重启后直接从缓存返回
+function getThumbnailPackDir() {
+  if (!thumbnailPackDir) {
+    thumbnailPackDir = path.join(app.getPath('home'), '.photo_manager', 'thumb_pack');
+    if (!fs.existsSync(thumbnailPackDir)) {
+      fs.mkdirSync(thumbnailPackDir, { recursive: true });
+    }
+  }
+  return thumbnailPackDir;
+}
+
 function getFileHash(filePath) {
   const stats = fs.statSync(filePath);
   const hashInput = `${filePath}:${stats.size}:${stats.mtime.getTime()}`;
@@ -93,106 +140,125 @@ function getThumbnailPath(filePath) {
   return path.join(getCacheDir(), `${hash}.jpg`);
 }
 
+// 只读文件头查找 SOI，再从该偏移按 JPEG 段结构读到 EOI，I/O 量约为“文件头 + 预览”而非整个 RAW
+const RAW_HEAD_BYTES = 512 * 1024;
+const RAW_READ_CHUNK = 1024 * 1024;
+
 function extractRawPreview(filePath) {
+  let fd = null;
   try {
-    const buffer = fs.readFileSync(filePath);
+    fd = fs.openSync(filePath, 'r');
+    const head = Buffer.alloc(RAW_HEAD_BYTES);
+    const headLength = fs.readSync(fd, head, 0, RAW_HEAD_BYTES, 0);
     const ext = path.extname(filePath).toLowerCase();
     
+    let start;
     if (['.cr2', '.cr3'].includes(ext)) {
-      return extractCanonPreview(buffer);
+      start = findJpegStart(head, headLength, 0, 100000);
     } else if (ext === '.arw') {
-      return extractSonyPreview(buffer);
+      start = findJpegStart(head, headLength, sonyPreviewOffset(head, headLength), 50000);
     } else if (ext === '.nef') {
-      return extractNikonPreview(buffer);
+      start = findJpegStart(head, headLength, 0, 100000);
     } else if (['.dng', '.raw'].includes(ext)) {
-      return extractTiffPreview(buffer);
+      start = findJpegStart(head, headLength, 0, 200000);
+    } else {
+      start = findJpegStart(head, headLength, 0, 500000);
     }
     
-    return extractGenericJpeg(buffer);
+    return start >= 0 ? readJpegFrom(fd, start) : null;
   } catch (error) {
     console.error('提取RAW预览失败:', error);
     return null;
+  } finally {
+    if (fd !== null) fs.closeSync(fd);
   }
 }
 
-function extractCanonPreview(buffer) {
-  let offset = 0;
-  while (offset < Math.min(buffer.length, 100000)) {
-    if (buffer[offset] === 0xFF && buffer[offset + 1] === 0xD8) {
-      let end = offset + 2;
-      while (end < buffer.length - 1) {
-        if (buffer[end] === 0xFF && buffer[end + 1] === 0xD9) {
-          return buffer.slice(offset, end + 2);
-        }
-        end++;
-      }
-    }
-    offset++;
-  }
-  return null;
+function sonyPreviewOffset(head, headLength) {
+  if (headLength < 8) return 0;
+  return head.readUInt32LE(4) === 0x49492A00 ? 8 : 0;
 }
 
-function extractSonyPreview(buffer) {
-  if (buffer.length < 8) return null;
-  
-  const le = buffer.readUInt32LE(4);
-  const offset = le === 0x49492A00 ? 8 : 0;
-  
-  for (let i = offset; i < Math.min(buffer.length, 50000); i++) {
-    if (buffer[i] === 0xFF && buffer[i + 1] === 0xD8) {
-      let end = i + 2;
-      while (end < buffer.length - 1) {
-        if (buffer[end] === 0xFF && buffer[end + 1] === 0xD9) {
-          return buffer.slice(i, end + 2);
-        }
-        end++;
-      }
-    }
-  }
-  return null;
-}
+// Buffer.indexOf 由 V8/Node 以原生代码批量查找，不再逐字节比较
+const JPEG_SOI = Buffer.from([0xFF, 0xD8, 0xFF]);
+// 单个内嵌预览的读取上限：没有 EOI 或结构损坏时最多读这么多就放弃
+const RAW_PREVIEW_MAX_BYTES = 64 * 1024 * 1024;
+const JPEG_MAX_SEGMENTS = 4096;
 
-function extractNikonPreview(buffer) {
-  for (let i = 0; i < Math.min(buffer.length, 100000); i++) {
-    if (buffer[i] === 0xFF && buffer[i + 1] === 0xD8) {
-      let end = i + 2;
-      while (end < buffer.length - 1) {
-        if (buffer[end] === 0xFF && buffer[end + 1] === 0xD9) {
-          return buffer.slice(i, end + 2);
-        }
-        end++;
-      }
-    }
-  }
-  return null;
+function findJpegStart(head, headLength, from, limit) {
+  const index = head.subarray(0, Math.min(headLength, limit + 2)).indexOf(JPEG_SOI, from);
+  return index >= 0 && index < limit ? index : -1;
 }
 
-function extractTiffPreview(buffer) {
-  for (let i = 0; i < Math.min(buffer.length, 200000); i++) {
-    if (buffer[i] === 0xFF && buffer[i + 1] === 0xD8) {
-      let end = i + 2;
-      while (end < buffer.length - 1) {
-        if (buffer[end] === 0xFF && buffer[end + 1] === 0xD9) {
-          return buffer.slice(i, end + 2);
-        }
-        end++;
+// 从 start 起按段长度遍历 JPEG（与 native WalkJpeg 相同）：APPn/DQT/DHT/SOF 整段跳过，
+// 只在 SOS 之后的熵编码数据中查找真正的 EOI，APP1 内 EXIF 缩略图的 EOI 不会提前截断。
+// 顺序读入的字节即为结果，读取量不超过 RAW_PREVIEW_MAX_BYTES，结构不合法时立即放弃
+function readJpegFrom(fd, start) {
+  let data = Buffer.alloc(RAW_READ_CHUNK);
+  let filled = 0;
+  
+  // 保证已读入 [start, start + end)；超出上限或到达文件末尾时返回 false
+  const ensure = (end) => {
+    if (end > RAW_PREVIEW_MAX_BYTES) return false;
+    while (filled < end) {
+      if (filled === data.length) {
+        const grown = Buffer.alloc(Math.min(data.length * 2, RAW_PREVIEW_MAX_BYTES));
+        data.copy(grown, 0, 0, filled);
+        data = grown;
       }
+      const bytesRead = fs.readSync(fd, data, filled, data.length - filled, start + filled);
+      if (bytesRead <= 0) return false;
+      filled += bytesRead;
     }
-  }
-  return null;
-}
-
-function extractGenericJpeg(buffer) {
-  for (let i = 0; i < Math.min(buffer.length, 500000); i++) {
-    if (buffer[i] === 0xFF && buffer[i + 1] === 0xD8) {
-      let end = i + 2;
-      while (end < buffer.length - 1) {
-        if (buffer[end] === 0xFF && buffer[end + 1] === 0xD9) {
-          return buffer.slice(i, end + 2);
-        }
-        end++;
+    return true;
+  };
+  
+  // 返回熵编码数据之后第一个标记（0xFF 后跟非 0x00、非 RSTn）的位置，找不到时返回 -1
+  const skipEntropyData = (from) => {
+    let i = from;
+    while (true) {
+      if (!ensure(i + 2)) return -1;
+      const ff = data.subarray(0, filled).indexOf(0xFF, i);
+      if (ff < 0) {
+        i = filled;
+        continue;
       }
+      if (!ensure(ff + 2)) return -1;
+      const code = data[ff + 1];
+      if (code !== 0x00 && (code < 0xD0 || code > 0xD7)) return ff;
+      i = ff + 2;
+    }
+  };
+  
+  let pos = 2;
+  let scanned = false;
+  for (let i = 0; i < JPEG_MAX_SEGMENTS; i++) {
+    if (!ensure(pos + 2) || data[pos] !== 0xFF) return null;
+    const marker = data[pos + 1];
+    if (marker === 0xFF) {
+      pos++;
+      continue;
     }
+    if (marker === 0xD9) {
+      return scanned ? Buffer.from(data.subarray(0, pos + 2)) : null;
+    }
+    if (marker === 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      pos += 2;
+      continue;
+    }
+    if (marker === 0x00 || marker === 0xD8) return null;
+    
+    if (!ensure(pos + 4)) return null;
+    const length = data.readUInt16BE(pos + 2);
+    if (length < 2) return null;
+    const next = pos + 2 + length;
+    if (marker === 0xDA) {
+      pos = skipEntropyData(next);
+      if (pos < 0) return null;
+      scanned = true;
+      continue;
+    }
+    pos = next;
   }
   return null;
 }
@@ -206,7 +272,7 @@ async function generateThumbnail(filePath, maxSize = THUMBNAIL_SIZE) {
     if (jpgProcessor === 'wic' && nativeBridge && nativeBridge.getWICThumbnail) {
       const wicResult = await nativeBridge.getWICThumbnail(filePath, maxSize);
       if (wicResult && wicResult.data) {
-        return Buffer.from(wicResult.data, 'base64');
+        return wicResult.data;
       }
     }
     
@@ -215,7 +281,9 @@ async function generateThumbnail(filePath, maxSize = THUMBNAIL_SIZE) {
     
     let imageBuffer;
     if (isRaw) {
-      imageBuffer = extractRawPreview(filePath);
+      // 只取够缩略图尺寸的最小内嵌预览，避免为小格子读取全尺寸 JPEG
+      const preview = nativeBridge ? await nativeBridge.getRawPreview(filePath, { minEdge: maxSize, autoRotate: true, index: getPreviewIndexPath(filePath) }) : null;
+      imageBuffer = preview ? preview.data : extractRawPreview(filePath);
       if (!imageBuffer) {
         return null;
       }
@@ -223,6 +291,17 @@ async function generateThumbnail(filePath, maxSize = THUMBNAIL_SIZE) {
       imageBuffer = fs.readFileSync(filePath);
     }
     
+    if (nativeBridge && imageBuffer[0] === 0xFF && imageBuffer[1] === 0xD8) {
+      const resized = await nativeBridge.resizeJpeg(imageBuffer, {
+        maxWidth: maxSize,
+        maxHeight: maxSize,
+        quality: thumbnailQuality
+      });
+      if (resized) {
+        return resized.data;
+      }
+    }
+    
     try {
       const thumbnail = await sharp(imageBuffer)
         .resize(maxSize, maxSize, {
@@ -479,6 +558,12 @@ ipcMain.handle('open-directory-dialog', async (event, options) => {
   return canceled ? null : filePaths[0];
 });
 
+// 渲染进程打开图库时登记根目录，RAW 预览索引按根目录划分
+ipcMain.handle('library:set-roots', (event, roots) => {
+  registerLibraryRoots(roots);
+  return true;
+});
+
 // 监听导出目录选择对话框请求
 ipcMain.handle('save-dialog', async (event, options) => {
   const { canceled, filePath } = await dialog.showSaveDialog(mainWindow, {
@@ -654,7 +739,7 @@ ipcMain.handle('image:get-preview', async (event, { filePath, previewSize }) =>
         
         if (wicResult && wicResult.data) {
           const result = { 
-            data: wicResult.data, 
+            data: wicResult.data.toString('base64'), 
             isRaw: true,
             width: wicResult.width,
             height: wicResult.height,
@@ -669,14 +754,16 @@ ipcMain.handle('image:get-preview', async (event, { filePath, previewSize }) =>
       }
       
       if (nativeBridge) {
-        const nativeResult = await nativeBridge.getRawPreview(filePath);
+        const nativeResult = await nativeBridge.getRawPreview(filePath, { autoRotate: true, index: getPreviewIndexPath(filePath) });
         console.log('[RAW Preview] Native result:', nativeResult ? `${nativeResult.width}x${nativeResult.height}` : 'null');
         if (nativeResult && nativeResult.data) {
           const result = { 
-            data: nativeResult.data, 
+            data: nativeResult.data.toString('base64'), 
             isRaw: true,
             width: nativeResult.width,
-            height: nativeResult.height
+            height: nativeResult.height,
+            // 未能在 native 侧转正时交给渲染端按方向显示
+            orientation: nativeResult.rotated ? 1 : nativeResult.orientation
           };
           rawPreviewCache.set(filePath, result);
           console.log('[RAW Preview] Using embedded JPEG');
@@ -814,15 +901,18 @@ ipcMain.handle('native:generate-thumbnails', async (event, { paths, options }) =
   }
   
   try {
-    const results = await nativeBridge.generateThumbnails(paths, options);
+    const results = await nativeBridge.generateThumbnails(paths, { cacheDir: getThumbnailPackDir(), ...options });
     // 将 Buffer 转换为 base64
     const processed = {};
     for (const [path, data] of Object.entries(results)) {
       if (data.data) {
         processed[path] = {
-          data: data.data.toString('base64'),
+          // 像素输出直接以 Uint8ClampedArray 经结构化克隆传给渲染端，可直接构造 ImageData
+          data: data.format === 'rgba' || data.format === 'bgra' ? data.data : data.data.toString('base64'),
           width: data.width,
-          height: data.height
+          height: data.height,
+          format: data.format,
+          cached: data.cached
         };
       }
     }
@@ -849,20 +939,81 @@ ipcMain.handle('native:read-exif-ratings', async (event, { paths }) => {
 });
 
 // 快速文件扫描
-ipcMain.handle('native:scan-files', async (event, { directories, extensions }) => {
+ipcMain.handle('native:scan-files', async (event, { directories, extensions, options }) => {
   if (!nativeBridge) {
     return { error: 'Native module not available' };
   }
   
+  registerLibraryRoots(directories);
   try {
-    const files = await nativeBridge.scanFiles(directories, extensions);
+    const files = await nativeBridge.scanFiles(directories, extensions, options);
     return files;
   } catch (error) {
+    if (error.name === 'AbortError') {
+      return { cancelled: true };
+    }
     console.error('[Native] Scan files error:', error);
     return { error: error.message };
   }
 });
 
+// 流式文件扫描：批次通过 native:scan-files-batch 推送给渲染进程
+ipcMain.handle('native:scan-files-stream', async (event, { streamId, directories, extensions, options }) => {
+  if (!nativeBridge) {
+    return { error: 'Native module not available' };
+  }
+  
+  registerLibraryRoots(directories);
+  try {
+    return await nativeBridge.scanFilesStream(directories, extensions, options, (files) => {
+      if (!event.sender.isDestroyed()) {
+        event.sender.send('native:scan-files-batch', { streamId, files });
+      }
+    });
+  } catch (error) {
+    console.error('[Native] Streaming scan error:', error);
+    return { error: error.message };
+  }
+});
+
+// 批量 RAW 预览：每个结果完成后通过 native:raw-preview-result 推送，data 为 Buffer（渲染进程收到 Uint8Array）
+// options.root 为这批文件所属的图库根；省略时按文件各自的根分组，每组使用自己的预览索引
+ipcMain.handle('native:get-raw-previews', async (event, { requestId, paths, options }) => {
+  if (!nativeBridge) {
+    return { error: 'Native module not available' };
+  }
+  
+  try {
+    const { root, ...batchOptions } = options || {};
+    const groups = new Map();
+    paths.forEach((filePath, index) => {
+      const indexPath = batchOptions.index || getPreviewIndexPath(filePath, root);
+      if (!groups.has(indexPath)) groups.set(indexPath, []);
+      groups.get(indexPath).push(index);
+    });
+    
+    const summary = { total: 0, succeeded: 0 };
+    for (const [indexPath, indices] of groups) {
+      const groupSummary = await nativeBridge.getRawPreviews(indices.map(i => paths[i]), { ...batchOptions, index: indexPath }, (result) => {
+        if (!event.sender.isDestroyed()) {
+          event.sender.send('native:raw-preview-result', { requestId, result: { ...result, index: indices[result.index] } });
+        }
+      });
+      if (!groupSummary) return { error: 'Batch RAW preview not available' };
+      summary.total += groupSummary.total;
+      summary.succeeded += groupSummary.succeeded;
+    }
+    return summary;
+  } catch (error) {
+    console.error('[Native] Batch RAW preview error:', error);
+    return { error: error.message };
+  }
+});
+
+ipcMain.handle('native:cancel-scan', (event, { group }) => {
+  return nativeBridge ? nativeBridge.cancelScan(group) : false;
+});
+
 // ==================== 设置模块 IPC 处理 ====================
 const { getSettings, getSetting, setSetting, setSettings, resetSettings } = require('./src/settings');
 
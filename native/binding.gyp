@@ -1,11 +1,33 @@
 {
+  "variables": {
+    "variables": {
+      "libjpeg_root%": ""
+    },
+    "libjpeg_root%": "<(libjpeg_root)",
+    "with_libjpeg%": "<!(node find_libjpeg.js enabled \"<(libjpeg_root)\")"
+  },
   "targets": [
     {
       "target_name": "quickpick_native",
       "sources": [
         "quickpick_native.cc",
         "raw_preview.cc",
-        "wic_raw_preview.cc"
+        "wic_raw_preview.cc",
+        "dir_walker.cc",
+        "work_pool.cc",
+        "scan_stream.cc",
+        "dir_snapshot.cc",
+        "file_pairing.cc",
+        "image_formats.cc",
+        "file_sort.cc",
+        "preview_locator.cc",
+        "marker_scan.cc",
+        "jpeg_codec.cc",
+        "preview_index.cc",
+        "image_resize.cc",
+        "jpeg_thumbnail.cc",
+        "cpu_features.cc",
+        "thumbnail_cache.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
@@ -40,6 +62,48 @@
         }],
         ["OS=='linux'", {
           "cflags_cc": ["-std:c++17", "-fvisibility=hidden"]
+        }],
+        ["with_libjpeg=='true'", {
+          "defines": ["QP_HAVE_LIBJPEG"],
+          "include_dirs": ["<!@(node find_libjpeg.js include_dirs \"<(libjpeg_root)\")"],
+          "libraries": ["<!@(node find_libjpeg.js libraries \"<(libjpeg_root)\")"]
+        }]
+      ]
+    },
+    {
+      "target_name": "scanner_bench",
+      "type": "executable",
+      "sources": [
+        "scanner_bench.cc",
+        "dir_walker.cc",
+        "work_pool.cc",
+        "image_formats.cc"
+      ],
+      "defines": [
+        "QP_SCAN_STATS"
+      ],
+      "cflags!": ["-fno-exceptions"],
+      "cflags_cc!": ["-fno-exceptions"],
+      "conditions": [
+        ["OS=='win'", {
+          "defines": [
+            "WIN32_LEAN_AND_MEAN"
+          ],
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": ["/std:c++17"]
+            }
+          }
+        }],
+        ["OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "MACOSX_DEPLOYMENT_TARGET": "10.15"
+          }
+        }],
+        ["OS=='linux'", {
+          "cflags_cc": ["-std=c++17"],
+          "ldflags": ["-pthread"]
         }]
       ]
     }
@@ -0,0 +1,5 @@
+#pragma once
+
+// x86 运行时 CPU 特性检测（结果缓存）；非 x86 平台恒为 false
+bool CpuHasSse41();
+bool CpuHasAvx2();
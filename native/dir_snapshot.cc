@@ -0,0 +1,908 @@
+#include <napi.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include "dir_walker.h"
+#include "image_formats.h"
+#include "work_pool.h"
+
+// ==================== Directory Snapshot ====================
+
+// 快照记录每个目录的 mtime 与其中匹配文件的 (inode, size, mtime)。
+// 重扫时目录 mtime 未变说明目录项没有增删，直接沿用旧记录，只继续检查子目录；
+// 文件原地改写不会改变目录 mtime，这类修改只在所在目录有增删时才会被发现。
+
+struct SnapshotFile {
+    std::string name;
+    uint64_t ino;
+    uint64_t size;
+    double mtime;
+};
+
+struct SnapshotDir {
+    double mtime;
+    std::vector<SnapshotFile> files;
+    std::vector<std::string> subdirs;
+};
+
+using Snapshot = std::unordered_map<std::string, SnapshotDir>;
+
+struct SnapshotDelta {
+    std::vector<FileInfo> added;
+    std::vector<FileInfo> modified;
+    std::vector<std::string> removed;
+    std::vector<std::string> errors;
+    size_t scannedDirs = 0;
+    size_t skippedDirs = 0;
+};
+
+static const char kSnapshotMagic[4] = {'Q', 'P', 'S', 'N'};
+static const uint32_t kSnapshotVersion = 1;
+
+#ifdef _WIN32
+static const char kPathSeparator = '\\';
+
+static std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#else
+static const char kPathSeparator = '/';
+#endif
+
+static FILE* OpenFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    return _wfopen(Utf8ToWide(path).c_str(), Utf8ToWide(mode).c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+// dev/ino 用于识别经符号链接重复到达的目录，Windows 下为 0（遍历本就不跟随目录联接）
+static bool GetDirectoryMtime(const std::string& path, double& mtime, uint64_t& dev, uint64_t& ino) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return false;
+    uint64_t ticks = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                     data.ftLastWriteTime.dwLowDateTime;
+    mtime = ticks / 10000.0 - 11644473600000.0;
+    dev = ino = 0;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    dev = st.st_dev;
+    ino = st.st_ino;
+#ifdef __APPLE__
+    mtime = static_cast<double>(st.st_mtimespec.tv_sec) * 1000.0 + st.st_mtimespec.tv_nsec / 1e6;
+#else
+    mtime = static_cast<double>(st.st_mtim.tv_sec) * 1000.0 + st.st_mtim.tv_nsec / 1e6;
+#endif
+#endif
+    return true;
+}
+
+// 快照键：根目录、扩展名与递归选项一致时旧快照才可复用
+static std::string SnapshotKey(const std::vector<std::string>& roots,
+                               const std::vector<std::string>& extensions,
+                               const ScanOptions& options) {
+    std::string key;
+    for (const auto& r : roots) key += r + '\n';
+    key += '|';
+    for (const auto& e : extensions) key += e + ';';
+    key += '|' + std::to_string(options.recursive ? options.maxDepth : 0);
+    return key;
+}
+
+class SnapshotWriter {
+public:
+    void U32(uint32_t v) { Raw(&v, sizeof(v)); }
+    void U64(uint64_t v) { Raw(&v, sizeof(v)); }
+    void F64(double v) { Raw(&v, sizeof(v)); }
+    void Str(const std::string& s) {
+        U32(static_cast<uint32_t>(s.size()));
+        buffer_.append(s);
+    }
+    void Raw(const void* p, size_t n) { buffer_.append(static_cast<const char*>(p), n); }
+    const std::string& Buffer() const { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(const std::vector<char>& data) : data_(data), pos_(0) {}
+
+    bool U32(uint32_t& v) { return Raw(&v, sizeof(v)); }
+    bool U64(uint64_t& v) { return Raw(&v, sizeof(v)); }
+    bool F64(double& v) { return Raw(&v, sizeof(v)); }
+    bool Str(std::string& s) {
+        uint32_t len;
+        if (!U32(len) || data_.size() - pos_ < len) return false;
+        s.assign(data_.data() + pos_, len);
+        pos_ += len;
+        return true;
+    }
+    bool Raw(void* p, size_t n) {
+        if (data_.size() - pos_ < n) return false;
+        memcpy(p, data_.data() + pos_, n);
+        pos_ += n;
+        return true;
+    }
+
+private:
+    const std::vector<char>& data_;
+    size_t pos_;
+};
+
+static bool LoadSnapshot(const std::string& path, const std::string& key, Snapshot& snapshot) {
+    FILE* file = OpenFile(path, "rb");
+    if (!file) return false;
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    std::vector<char> data(fileSize > 0 ? fileSize : 0);
+    size_t bytesRead = fread(data.data(), 1, data.size(), file);
+    fclose(file);
+    if (bytesRead != data.size()) return false;
+
+    SnapshotReader r(data);
+    char magic[4];
+    uint32_t version, dirCount;
+    std::string storedKey;
+
+    if (!r.Raw(magic, 4) || memcmp(magic, kSnapshotMagic, 4) != 0) return false;
+    if (!r.U32(version) || version != kSnapshotVersion) return false;
+    if (!r.Str(storedKey) || storedKey != key) return false;
+    if (!r.U32(dirCount)) return false;
+
+    snapshot.reserve(dirCount);
+    for (uint32_t i = 0; i < dirCount; i++) {
+        std::string dirPath;
+        SnapshotDir dir;
+        uint32_t fileCount, subdirCount;
+
+        if (!r.Str(dirPath) || !r.F64(dir.mtime) || !r.U32(fileCount)) return false;
+        dir.files.resize(fileCount);
+        for (auto& f : dir.files) {
+            if (!r.Str(f.name) || !r.U64(f.ino) || !r.U64(f.size) || !r.F64(f.mtime)) return false;
+        }
+
+        if (!r.U32(subdirCount)) return false;
+        dir.subdirs.resize(subdirCount);
+        for (auto& sub : dir.subdirs) {
+            if (!r.Str(sub)) return false;
+        }
+
+        snapshot.emplace(std::move(dirPath), std::move(dir));
+    }
+    return true;
+}
+
+static bool SaveSnapshot(const std::string& path, const std::string& key, const Snapshot& snapshot) {
+    SnapshotWriter w;
+    w.Raw(kSnapshotMagic, 4);
+    w.U32(kSnapshotVersion);
+    w.Str(key);
+    w.U32(static_cast<uint32_t>(snapshot.size()));
+
+    for (const auto& entry : snapshot) {
+        w.Str(entry.first);
+        w.F64(entry.second.mtime);
+        w.U32(static_cast<uint32_t>(entry.second.files.size()));
+        for (const auto& f : entry.second.files) {
+            w.Str(f.name);
+            w.U64(f.ino);
+            w.U64(f.size);
+            w.F64(f.mtime);
+        }
+        w.U32(static_cast<uint32_t>(entry.second.subdirs.size()));
+        for (const auto& sub : entry.second.subdirs) {
+            w.Str(sub);
+        }
+    }
+
+    // 先写临时文件再替换，避免中途退出留下半个快照
+    std::string tmpPath = path + ".tmp";
+    FILE* file = OpenFile(tmpPath, "wb");
+    if (!file) return false;
+
+    const std::string& buffer = w.Buffer();
+    bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) return false;
+
+#ifdef _WIN32
+    return MoveFileExW(Utf8ToWide(tmpPath).c_str(), Utf8ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+}
+
+class SnapshotScan {
+public:
+    SnapshotScan(const Snapshot& previous,
+                 const std::vector<std::string>& extensions,
+                 const ScanOptions& options,
+                 TaskGroup& group)
+        : previous_(previous), extensions_(extensions), options_(options), group_(group) {}
+
+    void Visit(std::string dirPath, int depth) {
+        auto prev = previous_.find(dirPath);
+        const SnapshotDir* prevDir = prev != previous_.end() ? &prev->second : nullptr;
+
+        SnapshotDir current;
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+        if (!GetDirectoryMtime(dirPath, current.mtime, dev, ino)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (prevDir) {
+                RemoveTreeLocked(dirPath);
+            } else {
+                delta_.errors.push_back("Cannot open directory: " + dirPath);
+            }
+            return;
+        }
+        // 与 ParallelWalk 相同按 (dev, ino) 去重，指向祖先目录的符号链接不会无限递归
+        if (!MarkVisited(dev, ino)) return;
+
+        bool descend = options_.recursive && (options_.maxDepth < 0 || depth < options_.maxDepth);
+        std::vector<FileInfo> added;
+        std::vector<FileInfo> modified;
+        std::vector<std::string> removed;
+        std::vector<std::string> removedDirs;
+        bool scanned = false;
+
+        if (prevDir && prevDir->mtime == current.mtime) {
+            current.files = prevDir->files;
+            current.subdirs = prevDir->subdirs;
+        } else {
+            std::vector<FileInfo> files;
+            if (!ListSingleDirectory(dirPath, extensions_, true, files, descend ? &current.subdirs : nullptr)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (prevDir) RemoveTreeLocked(dirPath);
+                delta_.errors.push_back("Cannot open directory: " + dirPath);
+                return;
+            }
+            scanned = true;
+
+            std::unordered_map<std::string, const SnapshotFile*> prevFiles;
+            if (prevDir) {
+                prevFiles.reserve(prevDir->files.size());
+                for (const auto& f : prevDir->files) prevFiles.emplace(f.name, &f);
+            }
+
+            current.files.reserve(files.size());
+            for (auto& f : files) {
+                current.files.push_back({f.name, f.ino, f.size, f.mtime});
+
+                auto it = prevFiles.find(f.name);
+                if (it == prevFiles.end()) {
+                    added.push_back(std::move(f));
+                    continue;
+                }
+
+                const SnapshotFile* old = it->second;
+                prevFiles.erase(it);
+                if (old->ino != f.ino || old->size != f.size || old->mtime != f.mtime) {
+                    modified.push_back(std::move(f));
+                }
+            }
+
+            for (const auto& entry : prevFiles) {
+                removed.push_back(dirPath + kPathSeparator + entry.first);
+            }
+
+            if (prevDir) {
+                std::unordered_set<std::string> currentSubdirs(current.subdirs.begin(), current.subdirs.end());
+                for (const auto& sub : prevDir->subdirs) {
+                    if (!currentSubdirs.count(sub)) removedDirs.push_back(sub);
+                }
+            }
+        }
+
+        if (descend) {
+            for (const auto& sub : current.subdirs) {
+                group_.Run([this, sub, depth]() { Visit(sub, depth + 1); });
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (scanned) delta_.scannedDirs++; else delta_.skippedDirs++;
+        std::move(added.begin(), added.end(), std::back_inserter(delta_.added));
+        std::move(modified.begin(), modified.end(), std::back_inserter(delta_.modified));
+        std::move(removed.begin(), removed.end(), std::back_inserter(delta_.removed));
+        for (const auto& sub : removedDirs) RemoveTreeLocked(sub);
+        next_[dirPath] = std::move(current);
+    }
+
+    SnapshotDelta& Delta() { return delta_; }
+    Snapshot& Next() { return next_; }
+
+private:
+    const Snapshot& previous_;
+    const std::vector<std::string>& extensions_;
+    const ScanOptions& options_;
+    TaskGroup& group_;
+    std::mutex mutex_;
+    SnapshotDelta delta_;
+    Snapshot next_;
+    std::set<std::pair<uint64_t, uint64_t>> visited_;
+
+    bool MarkVisited(uint64_t dev, uint64_t ino) {
+        if (dev == 0 && ino == 0) return true;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return visited_.insert({dev, ino}).second;
+    }
+
+    // 目录整体消失：旧快照中其下所有文件计为删除
+    void RemoveTreeLocked(const std::string& dirPath) {
+        auto it = previous_.find(dirPath);
+        if (it == previous_.end()) return;
+
+        for (const auto& f : it->second.files) {
+            delta_.removed.push_back(dirPath + kPathSeparator + f.name);
+        }
+        for (const auto& sub : it->second.subdirs) {
+            RemoveTreeLocked(sub);
+        }
+    }
+};
+
+static Napi::Object FileInfoToObject(Napi::Env env, const FileInfo& file) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("path", Napi::String::New(env, file.path));
+    obj.Set("name", Napi::String::New(env, file.name));
+    obj.Set("extension", Napi::String::New(env, file.extension));
+    obj.Set("isDirectory", Napi::Boolean::New(env, file.isDirectory));
+    obj.Set("size", Napi::Number::New(env, static_cast<double>(file.size)));
+    obj.Set("mtime", Napi::Number::New(env, file.mtime));
+    return obj;
+}
+
+static Napi::Array FileInfosToArray(Napi::Env env, const std::vector<FileInfo>& files) {
+    Napi::Array arr = Napi::Array::New(env, files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        arr.Set(static_cast<uint32_t>(i), FileInfoToObject(env, files[i]));
+    }
+    return arr;
+}
+
+static Napi::Array StringsToArray(Napi::Env env, const std::vector<std::string>& strings) {
+    Napi::Array arr = Napi::Array::New(env, strings.size());
+    for (size_t i = 0; i < strings.size(); i++) {
+        arr.Set(static_cast<uint32_t>(i), Napi::String::New(env, strings[i]));
+    }
+    return arr;
+}
+
+class SnapshotScanner : public Napi::AsyncWorker {
+public:
+    SnapshotScanner(Napi::Env& env,
+                    const std::vector<std::string>& directories,
+                    const std::vector<std::string>& extensions,
+                    const std::string& snapshotPath,
+                    const ScanOptions& options)
+        : Napi::AsyncWorker(env),
+          directories_(directories),
+          extensions_(extensions),
+          snapshotPath_(snapshotPath),
+          options_(options),
+          full_(false),
+          deferred_(Napi::Promise::Deferred::New(env)) {}
+
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute() {
+        std::string key = SnapshotKey(directories_, extensions_, options_);
+
+        Snapshot previous;
+        if (!LoadSnapshot(snapshotPath_, key, previous)) {
+            previous.clear();
+            full_ = true;
+        }
+
+        TaskGroup group(WorkStealingPool::Shared());
+        SnapshotScan scan(previous, extensions_, options_, group);
+        for (const auto& dir : directories_) {
+            group.Run([&scan, dir]() { scan.Visit(dir, 0); });
+        }
+        group.Wait();
+
+        delta_ = std::move(scan.Delta());
+        if (!SaveSnapshot(snapshotPath_, key, scan.Next())) {
+            delta_.errors.push_back("Cannot write snapshot: " + snapshotPath_);
+        }
+    }
+
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object response = Napi::Object::New(env);
+
+        response.Set("full", Napi::Boolean::New(env, full_));
+        response.Set("added", FileInfosToArray(env, delta_.added));
+        response.Set("modified", FileInfosToArray(env, delta_.modified));
+        response.Set("removed", StringsToArray(env, delta_.removed));
+        response.Set("scannedDirs", Napi::Number::New(env, static_cast<double>(delta_.scannedDirs)));
+        response.Set("skippedDirs", Napi::Number::New(env, static_cast<double>(delta_.skippedDirs)));
+
+        if (!delta_.errors.empty()) {
+            response.Set("errors", StringsToArray(env, delta_.errors));
+        }
+
+        deferred_.Resolve(response);
+    }
+
+    void OnError(const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    std::vector<std::string> directories_;
+    std::vector<std::string> extensions_;
+    std::string snapshotPath_;
+    ScanOptions options_;
+    bool full_;
+    SnapshotDelta delta_;
+    Napi::Promise::Deferred deferred_;
+};
+
+// ==================== Directory Watcher ====================
+
+// "overflow"：内核事件队列溢出，期间的变化已丢失，调用方应改用快照重扫；
+// "error"：某个目录无法监视（如 ENOSPC 达到 max_user_watches 上限），该子树的变化不会上报
+struct WatchEvent {
+    const char* type;   // "added" | "modified" | "removed" | "overflow" | "error"
+    FileInfo file;
+    std::string error;
+};
+
+#ifdef __linux__
+class DirectoryWatcher {
+public:
+    DirectoryWatcher(Napi::ThreadSafeFunction tsfn,
+                     const std::vector<std::string>& directories,
+                     const std::vector<std::string>& extensions,
+                     const ScanOptions& options)
+        : tsfn_(tsfn),
+          directories_(directories),
+          extensions_(extensions),
+          filter_(extensions),
+          options_(options),
+          inotifyFd_(-1),
+          running_(false),
+          stopped_(false) {
+        stopPipe_[0] = stopPipe_[1] = -1;
+    }
+
+    ~DirectoryWatcher() { Stop(); }
+
+    bool Start(std::string& error) {
+        inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd_ < 0 || pipe2(stopPipe_, O_CLOEXEC) != 0) {
+            error = "Cannot initialize inotify";
+            return false;
+        }
+
+        // 注册监视要遍历整棵目录树，放到监视线程上做，失败通过回调以 "error" 事件上报
+        running_ = true;
+        thread_ = std::thread(&DirectoryWatcher::Run, this);
+        return true;
+    }
+
+    void Stop() {
+        if (stopped_) return;
+        stopped_ = true;
+
+        if (running_) {
+            running_ = false;
+            char b = 1;
+            ssize_t ignored = write(stopPipe_[1], &b, 1);
+            (void)ignored;
+        }
+        if (thread_.joinable()) thread_.join();
+
+        if (inotifyFd_ >= 0) close(inotifyFd_);
+        if (stopPipe_[0] >= 0) close(stopPipe_[0]);
+        if (stopPipe_[1] >= 0) close(stopPipe_[1]);
+        inotifyFd_ = stopPipe_[0] = stopPipe_[1] = -1;
+
+        tsfn_.Release();
+    }
+
+private:
+    struct WatchedDir {
+        std::string path;
+        int depth;
+    };
+
+    Napi::ThreadSafeFunction tsfn_;
+    std::vector<std::string> directories_;
+    std::vector<std::string> extensions_;
+    ExtensionFilter filter_;
+    ScanOptions options_;
+    int inotifyFd_;
+    int stopPipe_[2];
+    std::atomic<bool> running_;
+    bool stopped_;
+    std::thread thread_;
+    std::unordered_map<int, WatchedDir> watches_;
+    std::unordered_set<std::string> known_;
+
+    bool Matches(const std::string& name) const {
+        if (filter_.MatchesAll()) return true;
+        size_t pos = name.find_last_of('.');
+        if (pos == std::string::npos) return false;
+        std::string ext = name.substr(pos);
+        for (auto& c : ext) c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+        return filter_.Matches(ext);
+    }
+
+    static void PushError(std::vector<WatchEvent>& events, const std::string& path, std::string message) {
+        FileInfo f{};
+        f.path = path;
+        f.isDirectory = true;
+        events.push_back({"error", std::move(f), std::move(message)});
+    }
+
+    // 为目录及其子目录注册监视；reportFiles 为 true 时把已存在的文件报告为新增（新建目录在监视生效前就可能写入了文件）。
+    // 无法监视的目录以 "error" 事件记入 events，其余子树照常注册
+    void AddWatchTree(const std::string& dirPath, int depth, bool reportFiles, std::vector<WatchEvent>& events) {
+        if (!running_) return;
+
+        uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_DELETE_SELF;
+        int wd = inotify_add_watch(inotifyFd_, dirPath.c_str(), mask | IN_ONLYDIR);
+        if (wd < 0) {
+            int err = errno;
+            PushError(events, dirPath, err == ENOSPC
+                ? "Cannot watch directory: inotify watch limit reached (fs.inotify.max_user_watches)"
+                : std::string("Cannot watch directory: ") + strerror(err));
+            return;
+        }
+        watches_[wd] = {dirPath, depth};
+
+        bool descend = options_.recursive && (options_.maxDepth < 0 || depth < options_.maxDepth);
+        std::vector<FileInfo> files;
+        std::vector<std::string> subdirs;
+        if (!ListSingleDirectory(dirPath, extensions_, reportFiles, files, descend ? &subdirs : nullptr)) {
+            return;
+        }
+
+        for (auto& f : files) {
+            if (known_.insert(f.path).second && reportFiles) {
+                events.push_back({"added", std::move(f), {}});
+            }
+        }
+        for (const auto& sub : subdirs) {
+            AddWatchTree(sub, depth + 1, reportFiles, events);
+        }
+    }
+
+    // 目录被移出或删除：注销它及其子目录的监视，避免之后在移走的树里写入被报告成旧路径下的新增，
+    // 也不再占用 max_user_watches 配额
+    void RemoveWatches(const std::string& dirPath) {
+        std::string prefix = dirPath + "/";
+        for (auto it = watches_.begin(); it != watches_.end();) {
+            const std::string& path = it->second.path;
+            if (path == dirPath || path.compare(0, prefix.size(), prefix) == 0) {
+                inotify_rm_watch(inotifyFd_, it->first);
+                it = watches_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void RemoveTree(const std::string& dirPath, std::vector<WatchEvent>& events) {
+        RemoveWatches(dirPath);
+        std::string prefix = dirPath + "/";
+        for (auto it = known_.begin(); it != known_.end();) {
+            if (it->compare(0, prefix.size(), prefix) == 0) {
+                FileInfo f{};
+                f.path = *it;
+                events.push_back({"removed", std::move(f), {}});
+                it = known_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void HandleEvent(const struct inotify_event* ev, std::vector<WatchEvent>& events) {
+        // 溢出事件的 wd 为 -1，不属于任何目录
+        if (ev->mask & IN_Q_OVERFLOW) {
+            events.push_back({"overflow", FileInfo{}, {}});
+            return;
+        }
+
+        auto it = watches_.find(ev->wd);
+        if (it == watches_.end()) return;
+
+        if (ev->mask & IN_IGNORED) {
+            watches_.erase(it);
+            return;
+        }
+        if (ev->len == 0) return;
+
+        WatchedDir dir = it->second;
+        std::string name = ev->name;
+        std::string path = dir.path + "/" + name;
+
+        if (ev->mask & IN_ISDIR) {
+            bool descend = options_.recursive && (options_.maxDepth < 0 || dir.depth < options_.maxDepth);
+            if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && descend) {
+                AddWatchTree(path, dir.depth + 1, true, events);
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                RemoveTree(path, events);
+            }
+            return;
+        }
+
+        if (!Matches(name)) return;
+
+        if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            if (known_.erase(path)) {
+                FileInfo f{};
+                f.path = path;
+                f.name = name;
+                events.push_back({"removed", std::move(f), {}});
+            }
+            return;
+        }
+
+        // 只在写入完成（IN_CLOSE_WRITE）或整体移入时上报，避免把写了一半的文件交给上层
+        if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0) return;
+
+            FileInfo f;
+            f.path = path;
+            f.name = name;
+            size_t pos = name.find_last_of('.');
+            if (pos != std::string::npos) {
+                f.extension = name.substr(pos);
+                for (auto& c : f.extension) c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+            }
+            f.isDirectory = false;
+            f.size = st.st_size;
+            f.mtime = static_cast<double>(st.st_mtim.tv_sec) * 1000.0 + st.st_mtim.tv_nsec / 1e6;
+            f.ino = st.st_ino;
+
+            bool isNew = known_.insert(path).second;
+            events.push_back({isNew ? "added" : "modified", std::move(f), {}});
+        }
+    }
+
+    // 把一批事件交给 JS 回调；回调已不可用时返回 false
+    bool Emit(std::vector<WatchEvent>& events) {
+        auto* batch = new std::vector<WatchEvent>(std::move(events));
+        events.clear();
+        napi_status status = tsfn_.BlockingCall(batch, [](Napi::Env env, Napi::Function callback,
+                                                         std::vector<WatchEvent>* data) {
+            Napi::Array arr = Napi::Array::New(env, data->size());
+            for (size_t i = 0; i < data->size(); i++) {
+                const WatchEvent& ev = (*data)[i];
+                Napi::Object obj = FileInfoToObject(env, ev.file);
+                obj.Set("type", Napi::String::New(env, ev.type));
+                if (!ev.error.empty()) obj.Set("error", Napi::String::New(env, ev.error));
+                arr.Set(static_cast<uint32_t>(i), obj);
+            }
+            delete data;
+            callback.Call({arr});
+        });
+        if (status != napi_ok) {
+            delete batch;
+            return false;
+        }
+        return true;
+    }
+
+    void Run() {
+        std::vector<WatchEvent> failures;
+        for (const auto& dir : directories_) {
+            AddWatchTree(dir, 0, false, failures);
+        }
+        if (!failures.empty() && !Emit(failures)) return;
+
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopPipe_[0], POLLIN, 0}};
+
+        while (running_) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents & POLLIN) break;
+
+            std::vector<WatchEvent> events;
+            while (true) {
+                ssize_t len = read(inotifyFd_, buffer, sizeof(buffer));
+                if (len <= 0) break;
+
+                for (char* p = buffer; p < buffer + len;) {
+                    const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                    HandleEvent(ev, events);
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+            }
+
+            if (events.empty()) continue;
+            if (!Emit(events)) break;
+        }
+    }
+};
+
+struct WatcherSlot {
+    napi_env env;
+    std::unique_ptr<DirectoryWatcher> watcher;
+};
+
+static std::map<int, WatcherSlot> g_watchers;
+static std::set<napi_env> g_cleanupEnvs;
+static std::mutex g_watchersMutex;
+static int g_nextWatchId = 1;
+
+// 环境销毁前停掉其中未关闭的监视器：线程安全函数随环境一起失效，不能留到静态析构时再释放
+static void StopEnvWatchers(void* arg) {
+    napi_env env = static_cast<napi_env>(arg);
+    std::vector<std::unique_ptr<DirectoryWatcher>> watchers;
+    {
+        std::lock_guard<std::mutex> lock(g_watchersMutex);
+        g_cleanupEnvs.erase(env);
+        for (auto it = g_watchers.begin(); it != g_watchers.end();) {
+            if (it->second.env == env) {
+                watchers.push_back(std::move(it->second.watcher));
+                it = g_watchers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& watcher : watchers) watcher->Stop();
+}
+#endif
+
+// ==================== Exported Functions ====================
+
+static bool ParseScanArgs(const Napi::CallbackInfo& info,
+                          std::vector<std::string>& directories,
+                          std::vector<std::string>& extensions,
+                          ScanOptions& options,
+                          size_t optionsIndex) {
+    if (info.Length() < 1 || !info[0].IsArray()) return false;
+
+    Napi::Array dirsArray = info[0].As<Napi::Array>();
+    directories.reserve(dirsArray.Length());
+    for (uint32_t i = 0; i < dirsArray.Length(); i++) {
+        directories.push_back(dirsArray.Get(i).As<Napi::String>().Utf8Value());
+    }
+
+    if (info.Length() > 1 && info[1].IsArray()) {
+        Napi::Array extArray = info[1].As<Napi::Array>();
+        extensions.reserve(extArray.Length());
+        for (uint32_t i = 0; i < extArray.Length(); i++) {
+            extensions.push_back(extArray.Get(i).As<Napi::String>().Utf8Value());
+        }
+    }
+
+    if (info.Length() > optionsIndex && info[optionsIndex].IsObject()) {
+        Napi::Object opts = info[optionsIndex].As<Napi::Object>();
+        if (opts.Has("recursive")) options.recursive = opts.Get("recursive").ToBoolean();
+        if (opts.Has("maxDepth")) options.maxDepth = opts.Get("maxDepth").As<Napi::Number>().Int32Value();
+    }
+    return true;
+}
+
+// scanSnapshot(directories, extensions, snapshotPath, options)
+Napi::Value ScanSnapshot(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<std::string> directories;
+    std::vector<std::string> extensions;
+    ScanOptions options;
+
+    if (info.Length() < 3 || !info[2].IsString() || !ParseScanArgs(info, directories, extensions, options, 3)) {
+        Napi::TypeError::New(env, "Expected (directories, extensions, snapshotPath, options)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string snapshotPath = info[2].As<Napi::String>().Utf8Value();
+
+    SnapshotScanner* worker = new SnapshotScanner(env, directories, extensions, snapshotPath, options);
+    worker->Queue();
+    return worker->GetPromise();
+}
+
+// watchDirectories(directories, extensions, options, onChange) -> watchId
+Napi::Value WatchDirectories(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+#ifdef __linux__
+    std::vector<std::string> directories;
+    std::vector<std::string> extensions;
+    ScanOptions options;
+
+    if (info.Length() < 4 || !info[3].IsFunction() || !ParseScanArgs(info, directories, extensions, options, 2)) {
+        Napi::TypeError::New(env, "Expected (directories, extensions, options, onChange)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
+        env, info[3].As<Napi::Function>(), "DirectoryWatcher", 0, 1);
+
+    auto watcher = std::make_unique<DirectoryWatcher>(tsfn, directories, extensions, options);
+    std::string error;
+    if (!watcher->Start(error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::lock_guard<std::mutex> lock(g_watchersMutex);
+    if (g_cleanupEnvs.insert(env).second) {
+        napi_add_env_cleanup_hook(env, StopEnvWatchers, static_cast<napi_env>(env));
+    }
+    int id = g_nextWatchId++;
+    g_watchers[id] = {env, std::move(watcher)};
+    return Napi::Number::New(env, id);
+#else
+    Napi::Error::New(env, "Directory watching requires inotify (Linux)").ThrowAsJavaScriptException();
+    return env.Null();
+#endif
+}
+
+Napi::Value UnwatchDirectories(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Expected watch id").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+#ifdef __linux__
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::unique_ptr<DirectoryWatcher> watcher;
+    {
+        std::lock_guard<std::mutex> lock(g_watchersMutex);
+        auto it = g_watchers.find(id);
+        if (it == g_watchers.end()) return Napi::Boolean::New(env, false);
+        watcher = std::move(it->second.watcher);
+        g_watchers.erase(it);
+    }
+    watcher->Stop();
+    return Napi::Boolean::New(env, true);
+#else
+    return Napi::Boolean::New(env, false);
+#endif
+}
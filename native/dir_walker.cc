@@ -0,0 +1,524 @@
+#include "dir_walker.h"
+#include "work_pool.h"
+#include "image_formats.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fileapi.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+#ifdef QP_SCAN_STATS
+#include <atomic>
+
+static std::atomic<uint64_t> g_statDirOpens(0);
+static std::atomic<uint64_t> g_statDirEntries(0);
+static std::atomic<uint64_t> g_statStatCalls(0);
+#define QP_SCAN_COUNT(counter) g_stat##counter.fetch_add(1, std::memory_order_relaxed)
+#else
+#define QP_SCAN_COUNT(counter) ((void)0)
+#endif
+
+namespace {
+
+struct DirBlock {
+    size_t root;
+    std::string dirPath;
+    std::vector<FileInfo> files;
+};
+
+struct SubDir {
+    std::string path;
+    uint64_t dev;
+    uint64_t ino;
+};
+
+std::string LowerExtension(const std::string& name) {
+    std::string ext;
+    size_t pos = name.find_last_of('.');
+    if (pos != std::string::npos) {
+        ext = name.substr(pos);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    }
+    return ext;
+}
+
+#ifndef _WIN32
+struct EntryStat {
+    bool isDirectory = false;
+    uint64_t size = 0;
+    double mtime = 0;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+};
+
+// 相对目录 fd 取元数据，不做整条路径解析；Linux 上用 statx 只请求需要的字段
+bool StatAt(int dirFd, const char* name, EntryStat& out) {
+    QP_SCAN_COUNT(StatCalls);
+#if defined(__linux__) && defined(STATX_SIZE)
+    struct statx stx;
+    unsigned mask = STATX_TYPE | STATX_SIZE | STATX_MTIME | STATX_INO;
+    if (statx(dirFd, name, AT_STATX_DONT_SYNC, mask, &stx) != 0) return false;
+    out.isDirectory = S_ISDIR(stx.stx_mode);
+    out.size = stx.stx_size;
+    out.mtime = static_cast<double>(stx.stx_mtime.tv_sec) * 1000.0 + stx.stx_mtime.tv_nsec / 1e6;
+    out.dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    out.ino = stx.stx_ino;
+#else
+    struct stat st;
+    if (fstatat(dirFd, name, &st, 0) != 0) return false;
+    out.isDirectory = S_ISDIR(st.st_mode);
+    out.size = st.st_size;
+#ifdef __APPLE__
+    out.mtime = static_cast<double>(st.st_mtimespec.tv_sec) * 1000.0 + st.st_mtimespec.tv_nsec / 1e6;
+#else
+    out.mtime = static_cast<double>(st.st_mtim.tv_sec) * 1000.0 + st.st_mtim.tv_nsec / 1e6;
+#endif
+    out.dev = st.st_dev;
+    out.ino = st.st_ino;
+#endif
+    return true;
+}
+#endif
+
+// 列出单个目录；subdirs 非空时顺带收集子目录供递归。
+// 类型优先取自目录项本身（Windows 的 find data、POSIX 的 d_type），
+// 只有类型未知、符号链接或调用方要求 size/mtime 时才对匹配的条目取元数据。
+bool ListDirectory(const std::string& dirPath,
+                   const ExtensionFilter& filter,
+                   bool withStat,
+                   DirBlock& block,
+                   std::vector<SubDir>* subdirs,
+                   ScanSink* sink,
+                   const CancelToken* cancel) {
+    // 大目录中途也要能停下，每读一批目录项检查一次
+    const size_t cancelCheckMask = 0xFF;
+    size_t entries = 0;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    std::string searchPath = dirPath + "\\*";
+
+    QP_SCAN_COUNT(DirOpens);
+    HANDLE hFind = FindFirstFileExA(searchPath.c_str(), FindExInfoBasic, &findData,
+                                    FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    do {
+        QP_SCAN_COUNT(DirEntries);
+        if (cancel && (++entries & cancelCheckMask) == 0 && cancel->IsCancelled()) break;
+
+        std::string name = findData.cFileName;
+        if (name == "." || name == "..") continue;
+
+        bool isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+        if (isDirectory) {
+            // 不跟随目录联接/符号链接，避免循环
+            if (subdirs && !(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                subdirs->push_back({dirPath + "\\" + name, 0, 0});
+            }
+            continue;
+        }
+
+        std::string ext = LowerExtension(name);
+        if (!filter.Matches(ext)) continue;
+
+        FileInfo info;
+        info.path = dirPath + "\\" + name;
+        info.name = std::move(name);
+        info.extension = std::move(ext);
+        info.isDirectory = false;
+        info.size = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+        info.ino = 0;
+
+        // FILETIME 为 1601 年起的 100ns 计数
+        uint64_t ticks = (static_cast<uint64_t>(findData.ftLastWriteTime.dwHighDateTime) << 32) |
+                         findData.ftLastWriteTime.dwLowDateTime;
+        info.mtime = ticks / 10000.0 - 11644473600000.0;
+
+        block.files.push_back(std::move(info));
+        if (sink && block.files.size() >= sink->BatchSize()) sink->Add(block.files);
+    } while (FindNextFileA(hFind, &findData) != 0);
+
+    FindClose(hFind);
+#else
+    QP_SCAN_COUNT(DirOpens);
+    int dirFd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return false;
+    }
+
+    DIR* dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return false;
+    }
+
+    // 子目录的去重键取 (父目录设备号, d_ino)，每个目录只多一次 fstat
+    uint64_t dirDev = 0;
+    if (subdirs) {
+        struct stat dirSt;
+        QP_SCAN_COUNT(StatCalls);
+        if (fstat(dirFd, &dirSt) == 0) dirDev = dirSt.st_dev;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        QP_SCAN_COUNT(DirEntries);
+        if (cancel && (++entries & cancelCheckMask) == 0 && cancel->IsCancelled()) break;
+
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        unsigned char type = entry->d_type;
+        EntryStat st;
+        bool haveStat = false;
+
+        // 符号链接与不支持 d_type 的文件系统需要实际解析一次
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            if (!StatAt(dirFd, name, st)) continue;
+            haveStat = true;
+            type = st.isDirectory ? DT_DIR : DT_REG;
+        }
+
+        if (type == DT_DIR) {
+            if (subdirs) {
+                subdirs->push_back({dirPath + "/" + name,
+                                    haveStat ? st.dev : dirDev,
+                                    haveStat ? st.ino : static_cast<uint64_t>(entry->d_ino)});
+            }
+            continue;
+        }
+
+        std::string ext = LowerExtension(name);
+        if (!filter.Matches(ext)) continue;
+
+        if (withStat && !haveStat && !StatAt(dirFd, name, st)) continue;
+
+        FileInfo info;
+        info.name = name;
+        info.path = dirPath + "/" + info.name;
+        info.extension = std::move(ext);
+        info.isDirectory = false;
+        info.size = withStat ? st.size : 0;
+        info.mtime = withStat ? st.mtime : 0;
+        info.ino = haveStat ? st.ino : static_cast<uint64_t>(entry->d_ino);
+
+        block.files.push_back(std::move(info));
+        if (sink && block.files.size() >= sink->BatchSize()) sink->Add(block.files);
+    }
+
+    closedir(dir);
+#endif
+    if (sink) sink->Add(block.files);
+    return true;
+}
+
+} // namespace
+
+bool ListSingleDirectory(const std::string& dirPath,
+                         const std::vector<std::string>& extensions,
+                         bool withStat,
+                         std::vector<FileInfo>& files,
+                         std::vector<std::string>* subdirs) {
+    DirBlock block;
+    block.root = 0;
+    std::vector<SubDir> found;
+
+    ExtensionFilter filter(extensions);
+    if (!ListDirectory(dirPath, filter, withStat, block, subdirs ? &found : nullptr, nullptr, nullptr)) {
+        return false;
+    }
+
+    files = std::move(block.files);
+    if (subdirs) {
+        subdirs->reserve(subdirs->size() + found.size());
+        for (auto& sub : found) subdirs->push_back(std::move(sub.path));
+    }
+    return true;
+}
+
+namespace {
+
+class ParallelWalk {
+public:
+    ParallelWalk(const ExtensionFilter& filter,
+                 const ScanOptions& options,
+                 TaskGroup& group,
+                 ScanSink* sink)
+        : filter_(filter), options_(options), group_(group), sink_(sink) {}
+
+    void Visit(size_t root, std::string dirPath, int depth) {
+        if (Cancelled()) return;
+
+        auto block = std::make_unique<DirBlock>();
+        block->root = root;
+        block->dirPath = dirPath;
+
+        bool descend = options_.maxDepth < 0 || depth < options_.maxDepth;
+        std::vector<SubDir> subdirs;
+
+        if (!ListDirectory(dirPath, filter_, options_.stat, *block, descend ? &subdirs : nullptr, sink_,
+                           options_.cancel.get())) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            errors_.push_back("Cannot open directory: " + dirPath);
+            return;
+        }
+
+        for (auto& sub : subdirs) {
+            if (Cancelled()) break;
+            if (!MarkVisited(sub)) continue;
+            group_.Run([this, root, path = std::move(sub.path), depth]() mutable {
+                Visit(root, std::move(path), depth + 1);
+            });
+        }
+
+        if (sink_) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.push_back(std::move(block));
+    }
+
+    void Collect(ScanOutput& output) {
+        std::sort(blocks_.begin(), blocks_.end(),
+                  [](const std::unique_ptr<DirBlock>& a, const std::unique_ptr<DirBlock>& b) {
+                      if (a->root != b->root) return a->root < b->root;
+                      return a->dirPath < b->dirPath;
+                  });
+
+        size_t total = output.files.size();
+        for (const auto& block : blocks_) total += block->files.size();
+        output.files.reserve(total);
+
+        for (auto& block : blocks_) {
+            std::move(block->files.begin(), block->files.end(), std::back_inserter(output.files));
+        }
+        output.errors.insert(output.errors.end(), errors_.begin(), errors_.end());
+    }
+
+    bool Cancelled() const {
+        return options_.cancel && options_.cancel->IsCancelled();
+    }
+
+    // 根目录同样登记 (dev, ino)，子目录里指回根的符号链接不会再扫一遍
+    bool MarkRoot(const std::string& dirPath) {
+#ifdef _WIN32
+        (void)dirPath;
+        return true;
+#else
+        struct stat st;
+        if (stat(dirPath.c_str(), &st) != 0) return true;
+        return MarkVisited({dirPath, static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino)});
+#endif
+    }
+
+private:
+    const ExtensionFilter& filter_;
+    const ScanOptions& options_;
+    TaskGroup& group_;
+    ScanSink* sink_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<DirBlock>> blocks_;
+    std::vector<std::string> errors_;
+    std::set<std::pair<uint64_t, uint64_t>> visited_;
+
+    bool MarkVisited(const SubDir& sub) {
+        if (sub.dev == 0 && sub.ino == 0) return true;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return visited_.insert({sub.dev, sub.ino}).second;
+    }
+};
+
+} // namespace
+
+void WalkDirectories(const std::vector<std::string>& directories,
+                     const std::vector<std::string>& extensions,
+                     const ScanOptions& options,
+                     ScanOutput& output,
+                     ScanSink* sink) {
+    ExtensionFilter filter(extensions);
+    bool flat = !options.recursive || options.maxDepth == 0;
+    if (flat && directories.size() <= 1) {
+        for (const auto& dir : directories) {
+            DirBlock block;
+            if (!ListDirectory(dir, filter, options.stat, block, nullptr, sink, options.cancel.get())) {
+                output.errors.push_back("Cannot open directory: " + dir);
+                continue;
+            }
+            output.files = std::move(block.files);
+        }
+        output.cancelled = options.cancel && options.cancel->IsCancelled();
+        if (sink && !output.cancelled) sink->Flush();
+        return;
+    }
+
+    ScanOptions walkOptions = options;
+    if (flat) walkOptions.maxDepth = 0;
+
+    std::unique_ptr<WorkStealingPool> ownPool;
+    if (options.threads > 0) {
+        ownPool = std::make_unique<WorkStealingPool>(options.threads);
+    }
+    WorkStealingPool& pool = ownPool ? *ownPool : WorkStealingPool::Shared();
+
+    TaskGroup group(pool, options.urgent);
+    ParallelWalk walk(filter, walkOptions, group, sink);
+
+    for (size_t i = 0; i < directories.size(); i++) {
+        if (!walk.MarkRoot(directories[i])) continue;
+        group.Run([&walk, i, &directories]() { walk.Visit(i, directories[i], 0); });
+    }
+    group.Wait();
+
+    if (walk.Cancelled()) {
+        output.cancelled = true;
+        return;
+    }
+
+    walk.Collect(output);
+    if (sink) sink->Flush();
+}
+
+void ScanSink::Add(std::vector<FileInfo>& files) {
+    if (files.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty()) {
+        pending_ = std::move(files);
+    } else {
+        pending_.reserve(pending_.size() + files.size());
+        std::move(files.begin(), files.end(), std::back_inserter(pending_));
+    }
+    files.clear();
+
+    if (pending_.size() >= batchSize_ ||
+        std::chrono::steady_clock::now() - lastFlush_ >= interval_) {
+        FlushLocked();
+    }
+}
+
+void ScanSink::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FlushLocked();
+}
+
+void ScanSink::FlushLocked() {
+    lastFlush_ = std::chrono::steady_clock::now();
+    if (pending_.empty()) return;
+
+    total_ += pending_.size();
+    std::vector<FileInfo> batch;
+    batch.swap(pending_);
+    callback_(std::move(batch));
+}
+
+ScanStats GetScanStats() {
+    ScanStats stats;
+#ifdef QP_SCAN_STATS
+    stats.dirOpens = g_statDirOpens.load();
+    stats.dirEntries = g_statDirEntries.load();
+    stats.statCalls = g_statStatCalls.load();
+#endif
+    return stats;
+}
+
+void ResetScanStats() {
+#ifdef QP_SCAN_STATS
+    g_statDirOpens = 0;
+    g_statDirEntries = 0;
+    g_statStatCalls = 0;
+#endif
+}
+
+static std::mutex g_scanGroupsMutex;
+static std::unordered_map<std::string, std::shared_ptr<CancelToken>> g_scanGroups;
+
+std::shared_ptr<CancelToken> BeginScan(const std::string& group) {
+    auto token = std::make_shared<CancelToken>();
+    if (group.empty()) return token;
+
+    std::lock_guard<std::mutex> lock(g_scanGroupsMutex);
+    auto& slot = g_scanGroups[group];
+    if (slot) slot->Cancel();
+    slot = token;
+    return token;
+}
+
+void EndScan(const std::string& group, const std::shared_ptr<CancelToken>& token) {
+    if (group.empty()) return;
+
+    std::lock_guard<std::mutex> lock(g_scanGroupsMutex);
+    auto it = g_scanGroups.find(group);
+    if (it != g_scanGroups.end() && it->second == token) g_scanGroups.erase(it);
+}
+
+bool CancelScan(const std::string& group) {
+    std::lock_guard<std::mutex> lock(g_scanGroupsMutex);
+    auto it = g_scanGroups.find(group);
+    if (it == g_scanGroups.end()) return false;
+
+    it->second->Cancel();
+    g_scanGroups.erase(it);
+    return true;
+}
+
+void BuildScanColumns(const FileInfo* files, size_t count, ScanColumns& columns) {
+    size_t totalPathBytes = 0;
+    for (size_t i = 0; i < count; i++) totalPathBytes += files[i].path.size();
+
+    columns.pathData.reserve(totalPathBytes);
+    columns.pathOffsets.reserve(count + 1);
+    columns.nameOffsets.reserve(count);
+    columns.extensionIds.reserve(count);
+    columns.size.reserve(count);
+    columns.mtime.reserve(count);
+    columns.flags.reserve(count);
+
+    std::unordered_map<std::string, uint8_t> extensionIds;
+    const uint8_t overflowId = 255;
+
+    columns.pathOffsets.push_back(0);
+    for (size_t i = 0; i < count; i++) {
+        const FileInfo& f = files[i];
+        columns.pathData.insert(columns.pathData.end(), f.path.begin(), f.path.end());
+        uint32_t end = static_cast<uint32_t>(columns.pathData.size());
+        columns.pathOffsets.push_back(end);
+        columns.nameOffsets.push_back(end - static_cast<uint32_t>(std::min(f.name.size(), f.path.size())));
+
+        auto it = extensionIds.find(f.extension);
+        uint8_t id;
+        if (it != extensionIds.end()) {
+            id = it->second;
+        } else if (columns.extensions.size() < overflowId) {
+            id = static_cast<uint8_t>(columns.extensions.size());
+            columns.extensions.push_back(f.extension);
+            extensionIds.emplace(f.extension, id);
+        } else {
+            id = overflowId;
+            if (columns.extensions.size() == overflowId) columns.extensions.push_back("");
+        }
+        columns.extensionIds.push_back(id);
+
+        columns.size.push_back(static_cast<double>(f.size));
+        columns.mtime.push_back(f.mtime);
+        columns.flags.push_back(f.isDirectory ? kScanFlagDirectory : 0);
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct FileInfo {
+    std::string path;
+    std::string name;
+    std::string extension;
+    bool isDirectory;
+    uint64_t size;
+    double mtime;           // 毫秒时间戳，未请求元数据时为 0
+    uint64_t ino;           // POSIX inode（取自 d_ino，无需 stat），Windows 下为 0
+};
+
+class CancelToken;
+
+struct ScanOptions {
+    bool recursive = false;
+    int maxDepth = -1;      // 递归深度上限，0 表示只扫描根目录，-1 表示不限
+    unsigned threads = 0;   // 并行遍历线程数，0 使用共享线程池
+    bool stat = true;       // 是否读取 size/mtime；关闭后仅靠目录项类型枚举，不产生逐文件 stat
+    bool columnar = false;  // 以列式定型数组返回结果（只影响输出格式，遍历本身不使用）
+    bool urgent = false;    // 高优先级：遍历任务进入线程池的优先队列
+    std::shared_ptr<CancelToken> cancel;    // 非空时每个目录批次之间检查，取消后尽快停止
+};
+
+// 列式扫描结果：路径拼接成一段 UTF-8，其余字段按列存放，避免逐文件创建 JS 对象
+enum ScanFileFlags : uint8_t {
+    kScanFlagDirectory = 1 << 0,
+};
+
+struct ScanColumns {
+    std::vector<char> pathData;             // 所有路径首尾相接
+    std::vector<uint32_t> pathOffsets;      // 第 i 个路径为 [pathOffsets[i], pathOffsets[i + 1])，共 count + 1 项
+    std::vector<uint32_t> nameOffsets;      // 文件名在 pathData 中的起点（文件名是路径的后缀）
+    std::vector<uint8_t> extensionIds;      // 指向 extensions 的下标
+    std::vector<std::string> extensions;    // 出现过的扩展名，按首次出现顺序
+    std::vector<double> size;
+    std::vector<double> mtime;
+    std::vector<uint8_t> flags;             // ScanFileFlags
+
+    size_t Count() const { return flags.size(); }
+};
+
+// 把 files 转成列式布局；扩展名种类超过 255 时多出的统一记为 255（extensions 中对应 ""）
+void BuildScanColumns(const FileInfo* files, size_t count, ScanColumns& columns);
+
+struct ScanOutput {
+    std::vector<FileInfo> files;
+    std::vector<std::string> errors;
+    bool cancelled = false; // 被取消时 files 不完整
+};
+
+// 流式输出：遍历线程每攒够 batchSize 个文件，或距上次输出超过 intervalMs，就把当前批次交给回调。
+// 回调在持锁状态下串行调用，批次之间互不重叠。
+class ScanSink {
+public:
+    using Callback = std::function<void(std::vector<FileInfo>&& batch)>;
+
+    explicit ScanSink(Callback callback, size_t batchSize = 512, int intervalMs = 16)
+        : callback_(std::move(callback)),
+          batchSize_(batchSize == 0 ? 1 : batchSize),
+          interval_(intervalMs),
+          lastFlush_(std::chrono::steady_clock::now()),
+          total_(0) {}
+
+    size_t BatchSize() const { return batchSize_; }
+    size_t Total() const { return total_; }
+
+    // 转移 files 中的条目（调用后 files 为空）
+    void Add(std::vector<FileInfo>& files);
+    void Flush();
+
+private:
+    void FlushLocked();
+
+    Callback callback_;
+    size_t batchSize_;
+    std::chrono::milliseconds interval_;
+    std::chrono::steady_clock::time_point lastFlush_;
+    std::mutex mutex_;
+    std::vector<FileInfo> pending_;
+    size_t total_;
+};
+
+// 列出单个目录（不递归）；subdirs 非空时收集子目录完整路径
+bool ListSingleDirectory(const std::string& dirPath,
+                         const std::vector<std::string>& extensions,
+                         bool withStat,
+                         std::vector<FileInfo>& files,
+                         std::vector<std::string>* subdirs);
+
+// 扫描 directories 下扩展名匹配 extensions（小写、带点，空表示全部）的文件。
+// 递归模式下子目录以任务形式投递到工作窃取线程池并行遍历，结果按根目录顺序和目录路径排序输出。
+// 传入 sink 时文件按发现顺序分批交给 sink，output.files 保持为空，只收集错误。
+void WalkDirectories(const std::vector<std::string>& directories,
+                     const std::vector<std::string>& extensions,
+                     const ScanOptions& options,
+                     ScanOutput& output,
+                     ScanSink* sink = nullptr);
+
+// 文件系统调用计数：目录打开（open/FindFirstFileEx）、读出的目录项、stat 类调用。
+// 只有定义 QP_SCAN_STATS 编译时才统计（基准程序使用），否则恒为 0。
+struct ScanStats {
+    uint64_t dirOpens = 0;
+    uint64_t dirEntries = 0;
+    uint64_t statCalls = 0;
+};
+
+ScanStats GetScanStats();
+void ResetScanStats();
+
+// 扫描分组：同一 group 发起新扫描时取消仍在进行的旧扫描（例如用户连续点击不同文件夹）。
+// group 为空时返回一个不登记的独立标记。
+std::shared_ptr<CancelToken> BeginScan(const std::string& group);
+// 扫描结束时注销；group 已被更新的扫描占用时不做任何事
+void EndScan(const std::string& group, const std::shared_ptr<CancelToken>& token);
+// 取消 group 当前的扫描，没有进行中的扫描时返回 false
+bool CancelScan(const std::string& group);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <napi.h>
+#include <cstring>
+#include <vector>
+
+// 把 native 侧已经填好的 vector 交给 JS，由 finalizer 释放，尽量不再复制一遍。
+// Electron 启用 V8 内存沙箱后不允许外部 ArrayBuffer（napi 返回 napi_no_external_buffers_allowed），
+// 这种情况下退化为一次拷贝，调用方无需区分。
+
+template <typename T>
+inline Napi::ArrayBuffer ExternalArrayBuffer(Napi::Env env, std::vector<T>&& data) {
+    size_t byteLength = data.size() * sizeof(T);
+    if (byteLength == 0) {
+        return Napi::ArrayBuffer::New(env, 0);
+    }
+
+    auto* holder = new std::vector<T>(std::move(data));
+    napi_value value;
+    napi_status status = napi_create_external_arraybuffer(
+        env, holder->data(), byteLength,
+        [](napi_env, void*, void* hint) { delete static_cast<std::vector<T>*>(hint); },
+        holder, &value);
+    if (status == napi_ok) {
+        return Napi::ArrayBuffer(env, value);
+    }
+
+    Napi::ArrayBuffer copy = Napi::ArrayBuffer::New(env, byteLength);
+    memcpy(copy.Data(), holder->data(), byteLength);
+    delete holder;
+    return copy;
+}
+
+template <typename ArrayType, typename T>
+inline ArrayType ExternalTypedArray(Napi::Env env, std::vector<T>&& data) {
+    size_t length = data.size();
+    return ArrayType::New(env, length, ExternalArrayBuffer(env, std::move(data)), 0);
+}
+
+// 像素数据用 Uint8ClampedArray，可直接 new ImageData(data, width, height)
+inline Napi::Uint8Array ExternalClampedArray(Napi::Env env, std::vector<uint8_t>&& data) {
+    size_t length = data.size();
+    return Napi::Uint8Array::New(env, length, ExternalArrayBuffer(env, std::move(data)), 0, napi_uint8_clamped_array);
+}
+
+// Node Buffer 版本，用于预览/缩略图等 JPEG 字节
+inline Napi::Buffer<uint8_t> ExternalBuffer(Napi::Env env, std::vector<uint8_t>&& data) {
+    if (data.empty()) {
+        return Napi::Buffer<uint8_t>::New(env, 0);
+    }
+
+    auto* holder = new std::vector<uint8_t>(std::move(data));
+    napi_value value;
+    napi_status status = napi_create_external_buffer(
+        env, holder->size(), holder->data(),
+        [](napi_env, void*, void* hint) { delete static_cast<std::vector<uint8_t>*>(hint); },
+        holder, &value);
+    if (status == napi_ok) {
+        return Napi::Buffer<uint8_t>(env, value);
+    }
+
+    Napi::Buffer<uint8_t> copy = Napi::Buffer<uint8_t>::Copy(env, holder->data(), holder->size());
+    delete holder;
+    return copy;
+}
@@ -0,0 +1,150 @@
+#include <napi.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// ==================== JPG/RAW Pairing ====================
+
+// 取文件名（去目录与最后一个扩展名）并转小写，作为配对键
+static std::string StemKey(const std::string& path) {
+    size_t start = path.find_last_of("/\\");
+    start = (start == std::string::npos) ? 0 : start + 1;
+
+    size_t end = path.find_last_of('.');
+    if (end == std::string::npos || end < start) end = path.size();
+
+    std::string key = path.substr(start, end - start);
+    for (auto& c : key) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return key;
+}
+
+struct PairBucket {
+    std::vector<int32_t> jpg;
+    std::vector<int32_t> raw;
+};
+
+// 同名文件可能出现在多个目录（如 100CANON/101CANON 各有 IMG_0001），
+// 同一键下按出现顺序一一配对，多出来的计为孤立文件
+class FilePairer : public Napi::AsyncWorker {
+public:
+    FilePairer(Napi::Env& env,
+               std::vector<std::string>&& jpgPaths,
+               std::vector<std::string>&& rawPaths)
+        : Napi::AsyncWorker(env),
+          jpgPaths_(std::move(jpgPaths)),
+          rawPaths_(std::move(rawPaths)),
+          paired_(0),
+          deferred_(Napi::Promise::Deferred::New(env)) {}
+
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute() {
+        std::unordered_map<std::string, PairBucket> buckets;
+        buckets.reserve(jpgPaths_.size() + rawPaths_.size());
+        std::vector<PairBucket*> order;
+        order.reserve(jpgPaths_.size() + rawPaths_.size());
+
+        for (size_t i = 0; i < jpgPaths_.size(); i++) {
+            auto result = buckets.try_emplace(StemKey(jpgPaths_[i]));
+            if (result.second) order.push_back(&result.first->second);
+            result.first->second.jpg.push_back(static_cast<int32_t>(i));
+        }
+        for (size_t i = 0; i < rawPaths_.size(); i++) {
+            auto result = buckets.try_emplace(StemKey(rawPaths_[i]));
+            if (result.second) order.push_back(&result.first->second);
+            result.first->second.raw.push_back(static_cast<int32_t>(i));
+        }
+
+        // 组的顺序：先按 JPG 出现顺序，再是只有 RAW 的组，与界面原有分组顺序一致
+        jpgColumn_.reserve(order.size());
+        rawColumn_.reserve(order.size());
+        for (PairBucket* bucket : order) {
+            size_t n = std::max(bucket->jpg.size(), bucket->raw.size());
+            for (size_t k = 0; k < n; k++) {
+                int32_t j = k < bucket->jpg.size() ? bucket->jpg[k] : -1;
+                int32_t r = k < bucket->raw.size() ? bucket->raw[k] : -1;
+                jpgColumn_.push_back(j);
+                rawColumn_.push_back(r);
+
+                if (j >= 0 && r >= 0) {
+                    paired_++;
+                } else if (j >= 0) {
+                    jpgOrphans_.push_back(static_cast<uint32_t>(j));
+                } else {
+                    rawOrphans_.push_back(static_cast<uint32_t>(r));
+                }
+            }
+        }
+    }
+
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+
+        result.Set("jpg", ToTypedArray<Napi::Int32Array>(env, jpgColumn_));
+        result.Set("raw", ToTypedArray<Napi::Int32Array>(env, rawColumn_));
+        result.Set("jpgOrphans", ToTypedArray<Napi::Uint32Array>(env, jpgOrphans_));
+        result.Set("rawOrphans", ToTypedArray<Napi::Uint32Array>(env, rawOrphans_));
+        result.Set("paired", Napi::Number::New(env, static_cast<double>(paired_)));
+
+        deferred_.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    std::vector<std::string> jpgPaths_;
+    std::vector<std::string> rawPaths_;
+    std::vector<int32_t> jpgColumn_;
+    std::vector<int32_t> rawColumn_;
+    std::vector<uint32_t> jpgOrphans_;
+    std::vector<uint32_t> rawOrphans_;
+    size_t paired_;
+    Napi::Promise::Deferred deferred_;
+
+    template <typename ArrayType, typename T>
+    static ArrayType ToTypedArray(Napi::Env env, const std::vector<T>& values) {
+        ArrayType arr = ArrayType::New(env, values.size());
+        if (!values.empty()) {
+            memcpy(arr.Data(), values.data(), values.size() * sizeof(T));
+        }
+        return arr;
+    }
+};
+
+static bool ReadPathList(const Napi::Value& value, std::vector<std::string>& paths) {
+    if (!value.IsArray()) return false;
+
+    Napi::Array arr = value.As<Napi::Array>();
+    paths.reserve(arr.Length());
+    for (uint32_t i = 0; i < arr.Length(); i++) {
+        paths.push_back(arr.Get(i).As<Napi::String>().Utf8Value());
+    }
+    return true;
+}
+
+// pairFiles(jpgPaths, rawPaths) -> { jpg: Int32Array, raw: Int32Array, jpgOrphans, rawOrphans, paired }
+// 第 i 组为 (jpg[i], raw[i])，缺失的一侧为 -1
+Napi::Value PairFiles(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<std::string> jpgPaths;
+    std::vector<std::string> rawPaths;
+
+    if (info.Length() < 2 || !ReadPathList(info[0], jpgPaths) || !ReadPathList(info[1], rawPaths)) {
+        Napi::TypeError::New(env, "Expected (jpgPaths, rawPaths) arrays").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    FilePairer* worker = new FilePairer(env, std::move(jpgPaths), std::move(rawPaths));
+    worker->Queue();
+    return worker->GetPromise();
+}
@@ -11,49 +11,89 @@
 #include <dirent.h>
 #endif
 
-struct FileInfo {
-    std::string path;
-    std::string name;
-    std::string extension;
-    bool isDirectory;
-    uint64_t size;
-};
+#include "dir_walker.h"
+#include "scan_columns.h"
+#include "file_sort.h"
+#include "work_pool.h"
 
 class FileScanner : public Napi::AsyncWorker {
 public:
     FileScanner(Napi::Env& env, 
                 const std::vector<std::string>& directories,
-                const std::vector<std::string>& extensions)
+                const std::vector<std::string>& extensions,
+                const ScanOptions& options,
+                const std::vector<SortKey>& sortKeys,
+                const std::string& group)
         : Napi::AsyncWorker(env),
           directories_(directories),
           extensions_(extensions),
+          options_(options),
+          sortKeys_(sortKeys),
+          group_(group),
+          cancelled_(false),
           deferred_(Napi::Promise::Deferred::New(env)) {}
     
     Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 protected:
     void Execute() {
-        for (const auto& dir : directories_) {
-            ScanDirectory(dir);
+        ScanOutput output;
+        WalkDirectories(directories_, extensions_, options_, output);
+        if (output.cancelled) {
+            cancelled_ = true;
+            return;
         }
+        
+        // 排序只产出排列下标，切换排序方式时 JS 端不需要重新取文件列表
+        WorkStealingPool& pool = WorkStealingPool::Shared();
+        for (SortKey key : sortKeys_) {
+            if (key == SortKey::CaptureTime && captureTimes_.size() != output.files.size()) {
+                captureTimes_ = ReadCaptureTimes(output.files, pool, options_.cancel.get());
+            }
+            if (options_.cancel->IsCancelled()) {
+                cancelled_ = true;
+                return;
+            }
+            orders_.push_back(SortPermutation(output.files, key, &captureTimes_, pool));
+        }
+        
+        if (options_.columnar) {
+            BuildScanColumns(output.files.data(), output.files.size(), columns_);
+        } else {
+            files_ = std::move(output.files);
+        }
+        errors_ = std::move(output.errors);
     }
     
     void OnOK() {
         Napi::Env env = Env();
-        Napi::Array results = Napi::Array::New(env, files_.size());
+        Napi::Object response = Napi::Object::New(env);
+        EndScan(group_, options_.cancel);
         
-        for (size_t i = 0; i < files_.size(); i++) {
-            Napi::Object obj = Napi::Object::New(env);
-            obj.Set("path", Napi::String::New(env, files_[i].path));
-            obj.Set("name", Napi::String::New(env, files_[i].name));
-            obj.Set("extension", Napi::String::New(env, files_[i].extension));
-            obj.Set("isDirectory", Napi::Boolean::New(env, files_[i].isDirectory));
-            obj.Set("size", Napi::Number::New(env, static_cast<double>(files_[i].size)));
-            results.Set(static_cast<uint32_t>(i), obj);
+        // 被同组新扫描取代或被 cancelScan 取消，结果不完整，直接丢弃
+        if (cancelled_) {
+            response.Set("files", Napi::Array::New(env, 0));
+            response.Set("cancelled", Napi::Boolean::New(env, true));
+            deferred_.Resolve(response);
+            return;
         }
         
-        Napi::Object response = Napi::Object::New(env);
-        response.Set("files", results);
+        if (options_.columnar) {
+            response.Set("files", ScanColumnsToObject(env, std::move(columns_), options_.stat));
+        } else {
+            response.Set("files", FilesToArray(env));
+        }
+        
+        if (!orders_.empty()) {
+            Napi::Object order = Napi::Object::New(env);
+            for (size_t i = 0; i < sortKeys_.size(); i++) {
+                order.Set(SortKeyName(sortKeys_[i]), ExternalTypedArray<Napi::Uint32Array>(env, std::move(orders_[i])));
+            }
+            response.Set("order", order);
+        }
+        if (!captureTimes_.empty()) {
+            response.Set("captureTime", ExternalTypedArray<Napi::Float64Array>(env, std::move(captureTimes_)));
+        }
         
         if (!errors_.empty()) {
             Napi::Array errorArray = Napi::Array::New(env, errors_.size());
@@ -67,94 +107,41 @@ protected:
     }
     
     void OnError(const Napi::Error& e) {
+        EndScan(group_, options_.cancel);
         deferred_.Reject(e.Value());
     }
 
 private:
+    Napi::Array FilesToArray(Napi::Env env) {
+        Napi::Array results = Napi::Array::New(env, files_.size());
+        
+        for (size_t i = 0; i < files_.size(); i++) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("path", Napi::String::New(env, files_[i].path));
+            obj.Set("name", Napi::String::New(env, files_[i].name));
+            obj.Set("extension", Napi::String::New(env, files_[i].extension));
+            obj.Set("isDirectory", Napi::Boolean::New(env, files_[i].isDirectory));
+            obj.Set("size", Napi::Number::New(env, static_cast<double>(files_[i].size)));
+            if (options_.stat) {
+                obj.Set("mtime", Napi::Number::New(env, files_[i].mtime));
+            }
+            results.Set(static_cast<uint32_t>(i), obj);
+        }
+        return results;
+    }
+    
     std::vector<std::string> directories_;
     std::vector<std::string> extensions_;
+    ScanOptions options_;
+    std::vector<SortKey> sortKeys_;
+    std::string group_;
+    bool cancelled_;
     Napi::Promise::Deferred deferred_;
     std::vector<FileInfo> files_;
+    ScanColumns columns_;
+    std::vector<std::vector<uint32_t>> orders_;
+    std::vector<double> captureTimes_;
     std::vector<std::string> errors_;
-    
-    void ScanDirectory(const std::string& dirPath) {
-#ifdef _WIN32
-        WIN32_FIND_DATAA findData;
-        std::string searchPath = dirPath + "\\*";
-        
-        HANDLE hFind = FindFirstFileA(searchPath.c_str(), &findData);
-        if (hFind == INVALID_HANDLE_VALUE) {
-            errors_.push_back("Cannot open directory: " + dirPath);
-            return;
-        }
-        
-        do {
-            std::string name = findData.cFileName;
-            if (name == "." || name == "..") continue;
-            
-            FileInfo info;
-            info.name = name;
-            info.path = dirPath + "\\" + name;
-            info.isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-            
-            if (!info.isDirectory) {
-                size_t pos = name.find_last_of('.');
-                if (pos != std::string::npos) {
-                    info.extension = name.substr(pos);
-                    std::transform(info.extension.begin(), info.extension.end(), 
-                                  info.extension.begin(), ::tolower);
-                }
-                
-                info.size = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
-                
-                if (extensions_.empty() || 
-                    std::find(extensions_.begin(), extensions_.end(), info.extension) != extensions_.end()) {
-                    files_.push_back(info);
-                }
-            }
-        } while (FindNextFileA(hFind, &findData) != 0);
-        
-        FindClose(hFind);
-#else
-        DIR* dir = opendir(dirPath.c_str());
-        if (!dir) {
-            errors_.push_back("Cannot open directory: " + dirPath);
-            return;
-        }
-        
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            std::string name = entry->d_name;
-            if (name == "." || name == "..") continue;
-            
-            FileInfo info;
-            info.name = name;
-            info.path = dirPath + "/" + name;
-            
-            struct stat st;
-            if (stat(info.path.c_str(), &st) == 0) {
-                info.isDirectory = S_ISDIR(st.st_mode);
-                info.size = st.st_size;
-            }
-            
-            if (!info.isDirectory) {
-                size_t pos = name.find_last_of('.');
-                if (pos != std::string::npos) {
-                    info.extension = name.substr(pos);
-                    std::transform(info.extension.begin(), info.extension.end(), 
-                                  info.extension.begin(), ::tolower);
-                }
-                
-                if (extensions_.empty() || 
-                    std::find(extensions_.begin(), extensions_.end(), info.extension) != extensions_.end()) {
-                    files_.push_back(info);
-                }
-            }
-        }
-        
-        closedir(dir);
-#endif
-    }
 };
 
 Napi::Value ScanFiles(const Napi::CallbackInfo& info) {
@@ -182,7 +169,47 @@ Napi::Value ScanFiles(const Napi::CallbackInfo& info) {
         }
     }
     
-    FileScanner* worker = new FileScanner(env, directories, extensions);
+    ScanOptions options;
+    std::vector<SortKey> sortKeys;
+    std::string group;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object opts = info[2].As<Napi::Object>();
+        if (opts.Has("recursive")) options.recursive = opts.Get("recursive").ToBoolean();
+        if (opts.Has("maxDepth")) options.maxDepth = opts.Get("maxDepth").As<Napi::Number>().Int32Value();
+        if (opts.Has("threads")) options.threads = opts.Get("threads").As<Napi::Number>().Uint32Value();
+        if (opts.Has("stat")) options.stat = opts.Get("stat").ToBoolean();
+        if (opts.Has("columnar")) options.columnar = opts.Get("columnar").ToBoolean();
+        if (opts.Has("group")) group = opts.Get("group").As<Napi::String>().Utf8Value();
+        if (opts.Has("priority")) options.urgent = opts.Get("priority").As<Napi::String>().Utf8Value() == "high";
+        
+        // sort: 'name' | 'mtime' | 'size' | 'captureTime'，或其数组（一次算出多种顺序）
+        if (opts.Has("sort")) {
+            Napi::Value sortValue = opts.Get("sort");
+            std::vector<std::string> names;
+            if (sortValue.IsArray()) {
+                Napi::Array sortArray = sortValue.As<Napi::Array>();
+                for (uint32_t i = 0; i < sortArray.Length(); i++) {
+                    names.push_back(sortArray.Get(i).As<Napi::String>().Utf8Value());
+                }
+            } else if (sortValue.IsString()) {
+                names.push_back(sortValue.As<Napi::String>().Utf8Value());
+            }
+            for (const auto& name : names) {
+                SortKey key;
+                if (!ParseSortKey(name, key)) {
+                    Napi::TypeError::New(env, "Unknown sort key: " + name).ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                sortKeys.push_back(key);
+                // mtime/size 以及读不到拍摄时间时的回退都依赖元数据，这些排序即使指定 stat: false 也要取
+                if (key != SortKey::Name) options.stat = true;
+            }
+        }
+    }
+    
+    options.cancel = BeginScan(group);
+    
+    FileScanner* worker = new FileScanner(env, directories, extensions, options, sortKeys, group);
     worker->Queue();
     return worker->GetPromise();
 }
@@ -0,0 +1,381 @@
+#include "file_sort.h"
+#include "work_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+
+static std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#endif
+
+namespace {
+
+// 每个排序块至少这么多元素才值得拆分到多个线程
+const size_t kMinParallelChunk = 4096;
+// JPEG 的 APP1 不超过 64KB，先读这么多，TIFF 结构中更远的 IFD 再单独读取
+const size_t kExifHeadBytes = 64 * 1024;
+
+inline char LowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// TIFF 结构的随机读取：先用已读入的文件头，越界的 IFD（部分 RAW 的 Exif IFD 在 100KB 之后）再按需读文件
+class TiffSource {
+public:
+    TiffSource(FILE* file, const uint8_t* head, size_t headSize, uint64_t base, bool littleEndian)
+        : file_(file), head_(head), headSize_(headSize), base_(base), little_(littleEndian) {}
+
+    bool Read(uint64_t offset, uint8_t* dst, size_t length) const {
+        uint64_t pos = base_ + offset;
+        if (pos + length <= headSize_) {
+            memcpy(dst, head_ + pos, length);
+            return true;
+        }
+        if (!file_) return false;
+#ifdef _WIN32
+        if (_fseeki64(file_, static_cast<int64_t>(pos), SEEK_SET) != 0) return false;
+#else
+        if (fseeko(file_, static_cast<off_t>(pos), SEEK_SET) != 0) return false;
+#endif
+        return fread(dst, 1, length, file_) == length;
+    }
+
+    bool U16(uint64_t offset, uint16_t& value) const {
+        uint8_t p[2];
+        if (!Read(offset, p, 2)) return false;
+        value = little_ ? static_cast<uint16_t>(p[0] | (p[1] << 8))
+                        : static_cast<uint16_t>((p[0] << 8) | p[1]);
+        return true;
+    }
+
+    bool U32(uint64_t offset, uint32_t& value) const {
+        uint8_t p[4];
+        if (!Read(offset, p, 4)) return false;
+        value = little_ ? (uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24))
+                        : ((uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]));
+        return true;
+    }
+
+private:
+    FILE* file_;
+    const uint8_t* head_;
+    size_t headSize_;
+    uint64_t base_;
+    bool little_;
+};
+
+// 在 IFD 中查找标签，返回值字段所在位置（相对 TIFF 头）与计数
+bool FindTag(const TiffSource& tiff, uint32_t ifdOffset, uint16_t tag, uint16_t& type, uint32_t& count, uint32_t& valueOffset) {
+    uint16_t entryCount;
+    if (!tiff.U16(ifdOffset, entryCount)) return false;
+
+    for (uint16_t i = 0; i < entryCount; i++) {
+        uint64_t entry = ifdOffset + 2 + uint64_t(i) * 12;
+        uint16_t entryTag;
+        if (!tiff.U16(entry, entryTag)) return false;
+        if (entryTag != tag) continue;
+
+        if (!tiff.U16(entry + 2, type) || !tiff.U32(entry + 4, count)) return false;
+        // ASCII 超过 4 字节时值字段存放偏移
+        if (type == 2 && count > 4) {
+            if (!tiff.U32(entry + 8, valueOffset)) return false;
+        } else {
+            valueOffset = static_cast<uint32_t>(entry + 8);
+        }
+        return true;
+    }
+    return false;
+}
+
+// "YYYY:MM:DD HH:MM:SS" -> 毫秒
+double ParseExifDateTime(const uint8_t* s, size_t length) {
+    if (length < 19) return 0;
+    auto num = [s](size_t pos, size_t len) {
+        int v = 0;
+        for (size_t i = 0; i < len; i++) {
+            if (!IsDigit(static_cast<char>(s[pos + i]))) return -1;
+            v = v * 10 + (s[pos + i] - '0');
+        }
+        return v;
+    };
+
+    int year = num(0, 4), month = num(5, 2), day = num(8, 2);
+    int hour = num(11, 2), minute = num(14, 2), second = num(17, 2);
+    if (year <= 0 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour < 0 || minute < 0 || second < 0) {
+        return 0;
+    }
+
+    // days_from_civil（Howard Hinnant）
+    int y = year - (month <= 2 ? 1 : 0);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    double days = static_cast<double>(era) * 146097.0 + doe - 719468;
+
+    return ((days * 24 + hour) * 60 + minute) * 60000.0 + second * 1000.0;
+}
+
+double ReadDateTag(const TiffSource& tiff, uint32_t ifd, uint16_t tag) {
+    uint16_t type;
+    uint32_t count, valueOffset;
+    if (!FindTag(tiff, ifd, tag, type, count, valueOffset) || type != 2 || count < 19) return 0;
+
+    uint8_t text[19];
+    if (!tiff.Read(valueOffset, text, sizeof(text))) return 0;
+    return ParseExifDateTime(text, sizeof(text));
+}
+
+// head 为文件开头，base 为 TIFF 头在文件中的位置
+double ReadTiffDateTime(FILE* file, const uint8_t* head, size_t headSize, uint64_t base) {
+    if (base + 8 > headSize) return 0;
+    const uint8_t* header = head + base;
+    bool little;
+    if (header[0] == 'I' && header[1] == 'I') little = true;
+    else if (header[0] == 'M' && header[1] == 'M') little = false;
+    else return 0;
+
+    TiffSource tiff(file, head, headSize, base, little);
+    uint32_t ifd0;
+    if (!tiff.U32(4, ifd0)) return 0;
+
+    uint16_t type;
+    uint32_t count, valueOffset;
+    uint32_t exifIfd = 0;
+    if (FindTag(tiff, ifd0, 0x8769, type, count, valueOffset)) {
+        tiff.U32(valueOffset, exifIfd);
+    }
+
+    // DateTimeOriginal，其次 DateTimeDigitized，最后 IFD0 的 DateTime
+    if (exifIfd != 0) {
+        for (uint16_t tag : {uint16_t(0x9003), uint16_t(0x9004)}) {
+            double t = ReadDateTag(tiff, exifIfd, tag);
+            if (t != 0) return t;
+        }
+    }
+    return ReadDateTag(tiff, ifd0, 0x0132);
+}
+
+double ReadJpegDateTime(FILE* file, const uint8_t* data, size_t size) {
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) return 0;
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) return 0;
+
+        size_t length = (size_t(data[pos + 2]) << 8) | data[pos + 3];
+        if (marker == 0xE1 && length >= 8 && pos + 10 <= size &&
+            memcmp(data + pos + 4, "Exif\0\0", 6) == 0) {
+            return ReadTiffDateTime(file, data, size, pos + 10);
+        }
+        pos += 2 + length;
+    }
+    return 0;
+}
+
+template <typename Less>
+void ParallelSort(std::vector<uint32_t>& index, Less less, WorkStealingPool& pool) {
+    size_t n = index.size();
+    size_t chunks = std::min<size_t>(pool.Size(), n / kMinParallelChunk);
+    if (chunks <= 1) {
+        std::sort(index.begin(), index.end(), less);
+        return;
+    }
+
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; i++) bounds[i] = n * i / chunks;
+
+    {
+        TaskGroup group(pool);
+        for (size_t i = 0; i < chunks; i++) {
+            group.Run([&index, &less, lo = bounds[i], hi = bounds[i + 1]]() {
+                std::sort(index.begin() + lo, index.begin() + hi, less);
+            });
+        }
+    }
+
+    // 两两归并，每轮各段之间并行
+    std::vector<uint32_t> buffer(n);
+    while (bounds.size() > 2) {
+        size_t segments = bounds.size() - 1;
+        std::vector<size_t> next;
+        next.push_back(0);
+        {
+            TaskGroup group(pool);
+            for (size_t i = 0; i + 1 < segments; i += 2) {
+                size_t lo = bounds[i], mid = bounds[i + 1], hi = bounds[i + 2];
+                group.Run([&index, &buffer, &less, lo, mid, hi]() {
+                    std::merge(index.begin() + lo, index.begin() + mid,
+                               index.begin() + mid, index.begin() + hi,
+                               buffer.begin() + lo, less);
+                });
+                next.push_back(hi);
+            }
+            if (segments % 2 == 1) {
+                size_t lo = bounds[segments - 1];
+                std::copy(index.begin() + lo, index.end(), buffer.begin() + lo);
+                next.push_back(n);
+            }
+        }
+        index.swap(buffer);
+        bounds.swap(next);
+    }
+}
+
+} // namespace
+
+bool ParseSortKey(const std::string& name, SortKey& key) {
+    if (name == "name") key = SortKey::Name;
+    else if (name == "mtime") key = SortKey::Mtime;
+    else if (name == "size") key = SortKey::Size;
+    else if (name == "captureTime") key = SortKey::CaptureTime;
+    else return false;
+    return true;
+}
+
+const char* SortKeyName(SortKey key) {
+    switch (key) {
+        case SortKey::Name: return "name";
+        case SortKey::Mtime: return "mtime";
+        case SortKey::Size: return "size";
+        case SortKey::CaptureTime: return "captureTime";
+    }
+    return "";
+}
+
+int NaturalCompare(const std::string& a, const std::string& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (IsDigit(a[i]) && IsDigit(b[j])) {
+            // 跳过前导零后先比位数再逐位比较，不会溢出
+            size_t zi = i, zj = j;
+            while (zi < a.size() && a[zi] == '0') zi++;
+            while (zj < b.size() && b[zj] == '0') zj++;
+            size_t ei = zi, ej = zj;
+            while (ei < a.size() && IsDigit(a[ei])) ei++;
+            while (ej < b.size() && IsDigit(b[ej])) ej++;
+
+            if (ei - zi != ej - zj) return (ei - zi) < (ej - zj) ? -1 : 1;
+            int cmp = a.compare(zi, ei - zi, b, zj, ej - zj);
+            if (cmp != 0) return cmp < 0 ? -1 : 1;
+            // 数值相等时前导零少的在前
+            if ((zi - i) != (zj - j)) return (zi - i) < (zj - j) ? -1 : 1;
+
+            i = ei;
+            j = ej;
+            continue;
+        }
+
+        char ca = LowerAscii(a[i]);
+        char cb = LowerAscii(b[j]);
+        if (ca != cb) return static_cast<unsigned char>(ca) < static_cast<unsigned char>(cb) ? -1 : 1;
+        i++;
+        j++;
+    }
+
+    if (i < a.size()) return 1;
+    if (j < b.size()) return -1;
+    return 0;
+}
+
+double ReadCaptureTime(const std::string& path) {
+#ifdef _WIN32
+    FILE* file = _wfopen(Utf8ToWide(path).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+    if (!file) return 0;
+
+    std::vector<uint8_t> head(kExifHeadBytes);
+    size_t bytesRead = fread(head.data(), 1, head.size(), file);
+
+    double t;
+    if (bytesRead >= 4 && head[0] == 0xFF && head[1] == 0xD8) {
+        t = ReadJpegDateTime(file, head.data(), bytesRead);
+    } else {
+        t = ReadTiffDateTime(file, head.data(), bytesRead, 0);
+    }
+    fclose(file);
+    return t;
+}
+
+std::vector<double> ReadCaptureTimes(const std::vector<FileInfo>& files, WorkStealingPool& pool,
+                                     const CancelToken* cancel) {
+    std::vector<double> times(files.size());
+    const size_t chunk = 64;
+
+    TaskGroup group(pool);
+    for (size_t start = 0; start < files.size(); start += chunk) {
+        group.Run([&files, &times, cancel, start, end = std::min(files.size(), start + chunk)]() {
+            if (cancel && cancel->IsCancelled()) return;
+            for (size_t i = start; i < end; i++) {
+                double t = ReadCaptureTime(files[i].path);
+                times[i] = t != 0 ? t : files[i].mtime;
+            }
+        });
+    }
+    group.Wait();
+    return times;
+}
+
+std::vector<uint32_t> SortPermutation(const std::vector<FileInfo>& files,
+                                      SortKey key,
+                                      const std::vector<double>* captureTimes,
+                                      WorkStealingPool& pool) {
+    std::vector<uint32_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+
+    // 下标作为最终比较项，保证全序且相等元素保持扫描顺序
+    switch (key) {
+        case SortKey::Name:
+            ParallelSort(order, [&files](uint32_t a, uint32_t b) {
+                int cmp = NaturalCompare(files[a].name, files[b].name);
+                return cmp != 0 ? cmp < 0 : a < b;
+            }, pool);
+            break;
+        case SortKey::Mtime:
+            ParallelSort(order, [&files](uint32_t a, uint32_t b) {
+                if (files[a].mtime != files[b].mtime) return files[a].mtime < files[b].mtime;
+                return a < b;
+            }, pool);
+            break;
+        case SortKey::Size:
+            ParallelSort(order, [&files](uint32_t a, uint32_t b) {
+                if (files[a].size != files[b].size) return files[a].size < files[b].size;
+                return a < b;
+            }, pool);
+            break;
+        case SortKey::CaptureTime: {
+            const std::vector<double>& times = *captureTimes;
+            ParallelSort(order, [&times](uint32_t a, uint32_t b) {
+                if (times[a] != times[b]) return times[a] < times[b];
+                return a < b;
+            }, pool);
+            break;
+        }
+    }
+    return order;
+}
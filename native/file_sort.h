@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dir_walker.h"
+
+class WorkStealingPool;
+class CancelToken;
+
+enum class SortKey : uint8_t {
+    Name,           // 自然序文件名：忽略 ASCII 大小写，数字串按数值比较（IMG_2 < IMG_10）
+    Mtime,
+    Size,
+    CaptureTime,    // EXIF DateTimeOriginal，读不到时退回 mtime
+};
+
+bool ParseSortKey(const std::string& name, SortKey& key);
+const char* SortKeyName(SortKey key);
+
+int NaturalCompare(const std::string& a, const std::string& b);
+
+// 读取拍摄时间（毫秒，按 UTC 解释 EXIF 本地时间，只用于排序），失败返回 0。
+// 支持 JPEG APP1 与 TIFF 结构的 RAW，只读文件头部。
+double ReadCaptureTime(const std::string& path);
+
+// 在 pool 上并行读取 files 的拍摄时间，读不到的取 mtime；cancel 被触发后剩余文件不再读取
+std::vector<double> ReadCaptureTimes(const std::vector<FileInfo>& files, WorkStealingPool& pool,
+                                     const CancelToken* cancel = nullptr);
+
+// 返回按 key 升序的排列下标（order[k] 为第 k 个文件在 files 中的下标），相等时保持原顺序。
+// captureTimes 仅在 key 为 CaptureTime 时使用。
+std::vector<uint32_t> SortPermutation(const std::vector<FileInfo>& files,
+                                      SortKey key,
+                                      const std::vector<double>* captureTimes,
+                                      WorkStealingPool& pool);
@@ -0,0 +1,85 @@
+// 供 binding.gyp 调用：定位 libjpeg(-turbo)，默认启用。
+//   node find_libjpeg.js enabled                 -> "true" / "false"
+//   node find_libjpeg.js include_dirs [root]     -> 头文件目录
+//   node find_libjpeg.js libraries [root]        -> 链接参数
+// 查找顺序：root 参数 / LIBJPEG_ROOT 环境变量 → pkg-config（Linux/mac）→ 常见安装位置
+// （libjpeg-turbo 官方 Windows 安装包、vcpkg、Homebrew）。
+// 设置 QP_WITHOUT_LIBJPEG=1 或 gyp 参数 -Dwith_libjpeg=false 可显式关闭。
+const fs = require('fs');
+const path = require('path');
+const { execFileSync } = require('child_process');
+
+function pkgConfig(args) {
+    try {
+        return execFileSync('pkg-config', args, { encoding: 'utf8', stdio: ['ignore', 'pipe', 'ignore'] }).trim();
+    } catch (e) {
+        return null;
+    }
+}
+
+function candidateRoots(explicitRoot) {
+    const roots = [];
+    if (explicitRoot) roots.push(explicitRoot);
+    if (process.env.LIBJPEG_ROOT) roots.push(process.env.LIBJPEG_ROOT);
+    if (process.platform === 'win32') {
+        roots.push('C:\\libjpeg-turbo64', 'C:\\libjpeg-turbo');
+        if (process.env.VCPKG_ROOT) {
+            roots.push(path.join(process.env.VCPKG_ROOT, 'installed', 'x64-windows-static'));
+            roots.push(path.join(process.env.VCPKG_ROOT, 'installed', 'x64-windows'));
+        }
+    } else {
+        roots.push('/opt/homebrew/opt/jpeg-turbo', '/usr/local/opt/jpeg-turbo', '/usr/local', '/usr');
+    }
+    return roots;
+}
+
+function windowsLibrary(root) {
+    for (const name of ['jpeg-static.lib', 'turbojpeg-static.lib', 'jpeg.lib']) {
+        const lib = path.join(root, 'lib', name);
+        if (fs.existsSync(lib)) return lib;
+    }
+    return null;
+}
+
+function locate(explicitRoot) {
+    if (process.env.QP_WITHOUT_LIBJPEG === '1') return null;
+
+    // 显式指定的根目录优先于 pkg-config
+    const roots = candidateRoots(explicitRoot);
+    const explicit = explicitRoot || process.env.LIBJPEG_ROOT;
+    if (!explicit && process.platform !== 'win32' && pkgConfig(['--exists', 'libjpeg']) !== null) {
+        const includes = pkgConfig(['--cflags-only-I', 'libjpeg']).split(/\s+/).filter(Boolean).map((f) => f.slice(2));
+        return { includeDirs: includes, libraries: pkgConfig(['--libs', 'libjpeg']).split(/\s+/).filter(Boolean) };
+    }
+
+    for (const root of roots) {
+        if (!fs.existsSync(path.join(root, 'include', 'jpeglib.h'))) continue;
+        if (process.platform === 'win32') {
+            const lib = windowsLibrary(root);
+            if (lib) return { includeDirs: [path.join(root, 'include')], libraries: [lib] };
+        } else {
+            return { includeDirs: [path.join(root, 'include')], libraries: ['-L' + path.join(root, 'lib'), '-ljpeg'] };
+        }
+    }
+    return null;
+}
+
+const [mode, root] = process.argv.slice(2);
+const found = locate(root);
+
+if (mode === 'enabled') {
+    if (!found && process.env.QP_WITHOUT_LIBJPEG !== '1') {
+        console.error('[quickpick_native] libjpeg(-turbo) not found: thumbnails will be passed through undecoded.\n' +
+                      '  Install libjpeg-turbo (apt install libjpeg-turbo8-dev / brew install jpeg-turbo /\n' +
+                      '  the official Windows installer or vcpkg), or set LIBJPEG_ROOT to its install prefix.\n' +
+                      '  Set QP_WITHOUT_LIBJPEG=1 to build without it deliberately.');
+    }
+    console.log(found ? 'true' : 'false');
+} else if (mode === 'include_dirs') {
+    console.log(found ? found.includeDirs.join(' ') : '');
+} else if (mode === 'libraries') {
+    console.log(found ? found.libraries.join(' ') : '');
+} else {
+    console.error('usage: node find_libjpeg.js enabled|include_dirs|libraries [root]');
+    process.exit(1);
+}
@@ -0,0 +1,34 @@
+#include "image_formats.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+
+static std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#endif
+
+ImageFormat DetectImageFormat(const std::string& path, bool sniff) {
+    ImageFormat byExtension = FormatFromPath(path);
+    if (!sniff) return byExtension;
+
+#ifdef _WIN32
+    FILE* file = _wfopen(Utf8ToWide(path).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+    if (!file) return byExtension;
+
+    uint8_t header[kFormatSniffBytes];
+    size_t bytesRead = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    return ResolveFormat(byExtension, SniffFormat(header, bytesRead));
+}
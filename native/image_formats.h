@@ -0,0 +1,255 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// 全部 native 模块共用的图片格式注册表：扩展名 → 格式 id 走编译期生成的完美哈希表，
+// 另可嗅探文件头魔数，让扩展名不对的文件也能走到正确的解析路径。
+
+enum class ImageFormat : uint8_t {
+    Unknown = 0,
+    Jpeg,
+    Png,
+    Tiff,       // 仅凭魔数无法细分的 TIFF 容器
+    Cr2,
+    Cr3,
+    Nef,
+    Arw,
+    Dng,
+    Raf,
+    Orf,
+    Rw2,
+    Pef,
+    Srw,
+    X3f,
+    Raw,
+};
+
+constexpr bool IsRawFormat(ImageFormat format) {
+    return format >= ImageFormat::Cr2 && format <= ImageFormat::Raw;
+}
+
+// 以 TIFF/IFD 结构组织、内嵌预览可按 IFD 定位的格式
+constexpr bool IsTiffBasedFormat(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::Tiff:
+        case ImageFormat::Cr2:
+        case ImageFormat::Nef:
+        case ImageFormat::Arw:
+        case ImageFormat::Dng:
+        case ImageFormat::Orf:
+        case ImageFormat::Rw2:
+        case ImageFormat::Pef:
+        case ImageFormat::Srw:
+        case ImageFormat::Raw:
+            return true;
+        default:
+            return false;
+    }
+}
+
+constexpr const char* ImageFormatName(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::Jpeg: return "jpeg";
+        case ImageFormat::Png:  return "png";
+        case ImageFormat::Tiff: return "tiff";
+        case ImageFormat::Cr2:  return "cr2";
+        case ImageFormat::Cr3:  return "cr3";
+        case ImageFormat::Nef:  return "nef";
+        case ImageFormat::Arw:  return "arw";
+        case ImageFormat::Dng:  return "dng";
+        case ImageFormat::Raf:  return "raf";
+        case ImageFormat::Orf:  return "orf";
+        case ImageFormat::Rw2:  return "rw2";
+        case ImageFormat::Pef:  return "pef";
+        case ImageFormat::Srw:  return "srw";
+        case ImageFormat::X3f:  return "x3f";
+        case ImageFormat::Raw:  return "raw";
+        default:                return "unknown";
+    }
+}
+
+namespace image_formats_detail {
+
+struct ExtensionEntry {
+    std::string_view ext;   // 小写、带点
+    ImageFormat format;
+};
+
+constexpr ExtensionEntry kExtensions[] = {
+    {".jpg", ImageFormat::Jpeg}, {".jpeg", ImageFormat::Jpeg}, {".png", ImageFormat::Png},
+    {".tif", ImageFormat::Tiff}, {".tiff", ImageFormat::Tiff},
+    {".cr2", ImageFormat::Cr2},  {".cr3", ImageFormat::Cr3},   {".nef", ImageFormat::Nef},
+    {".arw", ImageFormat::Arw},  {".dng", ImageFormat::Dng},   {".raf", ImageFormat::Raf},
+    {".orf", ImageFormat::Orf},  {".rw2", ImageFormat::Rw2},   {".pef", ImageFormat::Pef},
+    {".srw", ImageFormat::Srw},  {".x3f", ImageFormat::X3f},   {".raw", ImageFormat::Raw},
+};
+
+constexpr size_t kTableBits = 6;
+constexpr size_t kTableSize = size_t(1) << kTableBits;     // 与 ExtensionFilter 的 64 位掩码对应
+constexpr size_t kMaxExtLength = 8;
+
+constexpr char Lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 带种子的 FNV-1a，取高位作为槽位
+constexpr uint32_t Hash(std::string_view s, uint32_t seed) {
+    uint32_t h = seed;
+    for (char c : s) {
+        h = (h ^ static_cast<uint8_t>(Lower(c))) * 16777619u;
+    }
+    return h >> (32 - kTableBits);
+}
+
+constexpr bool SeedIsPerfect(uint32_t seed) {
+    bool used[kTableSize] = {};
+    for (const auto& entry : kExtensions) {
+        uint32_t slot = Hash(entry.ext, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t FindSeed() {
+    for (uint32_t seed = 2166136261u; seed < 2166136261u + 100000u; seed++) {
+        if (SeedIsPerfect(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t kSeed = FindSeed();
+static_assert(kSeed != 0, "no collision-free seed for the extension table");
+
+struct Slot {
+    std::string_view ext;
+    ImageFormat format = ImageFormat::Unknown;
+};
+
+constexpr std::array<Slot, kTableSize> BuildTable() {
+    std::array<Slot, kTableSize> table{};
+    for (const auto& entry : kExtensions) {
+        table[Hash(entry.ext, kSeed)] = {entry.ext, entry.format};
+    }
+    return table;
+}
+
+constexpr std::array<Slot, kTableSize> kTable = BuildTable();
+
+} // namespace image_formats_detail
+
+// 扩展名（带点，大小写不敏感）在注册表中的槽位，不在表中返回 -1
+constexpr int ExtensionSlot(std::string_view ext) {
+    using namespace image_formats_detail;
+    if (ext.empty() || ext.size() > kMaxExtLength) return -1;
+
+    uint32_t slot = Hash(ext, kSeed);
+    const Slot& entry = kTable[slot];
+    if (entry.ext.size() != ext.size()) return -1;
+    for (size_t i = 0; i < ext.size(); i++) {
+        if (Lower(ext[i]) != entry.ext[i]) return -1;
+    }
+    return static_cast<int>(slot);
+}
+
+constexpr ImageFormat FormatFromExtension(std::string_view ext) {
+    int slot = ExtensionSlot(ext);
+    return slot < 0 ? ImageFormat::Unknown : image_formats_detail::kTable[slot].format;
+}
+
+constexpr ImageFormat FormatFromPath(std::string_view path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string_view::npos) return ImageFormat::Unknown;
+    size_t sep = path.find_last_of("/\\");
+    if (sep != std::string_view::npos && sep > dot) return ImageFormat::Unknown;
+    return FormatFromExtension(path.substr(dot));
+}
+
+static_assert(FormatFromExtension(".CR3") == ImageFormat::Cr3, "extension lookup must ignore case");
+static_assert(FormatFromExtension(".jpe") == ImageFormat::Unknown, "non-members must miss");
+static_assert(FormatFromPath("C:\\DCIM\\IMG_0001.NEF") == ImageFormat::Nef, "path lookup");
+
+// 魔数嗅探需要的文件头长度
+constexpr size_t kFormatSniffBytes = 16;
+
+// 按文件头判断格式：JPEG SOI、PNG、TIFF II/MM（含 CR2/ORF/RW2 变体）、ISO-BMFF ftyp crx、RAF、X3F
+inline ImageFormat SniffFormat(const uint8_t* data, size_t size) {
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+        return ImageFormat::Jpeg;
+    }
+    if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        return ImageFormat::Png;
+    }
+    if (size >= 12 && memcmp(data + 4, "ftyp", 4) == 0) {
+        return memcmp(data + 8, "crx ", 4) == 0 ? ImageFormat::Cr3 : ImageFormat::Unknown;
+    }
+    if (size >= 8 && memcmp(data, "FUJIFILM", 8) == 0) {
+        return ImageFormat::Raf;
+    }
+    if (size >= 4 && memcmp(data, "FOVb", 4) == 0) {
+        return ImageFormat::X3f;
+    }
+    if (size >= 4 && data[0] == 'I' && data[1] == 'I') {
+        uint16_t magic = static_cast<uint16_t>(data[2] | (data[3] << 8));
+        if (magic == 42) {
+            return (size >= 10 && data[8] == 'C' && data[9] == 'R') ? ImageFormat::Cr2 : ImageFormat::Tiff;
+        }
+        if (magic == 0x55) return ImageFormat::Rw2;
+        if (magic == 0x4F52 || magic == 0x5352) return ImageFormat::Orf;   // "IIRO" / "IIRS"
+    }
+    if (size >= 4 && data[0] == 'M' && data[1] == 'M') {
+        uint16_t magic = static_cast<uint16_t>((data[2] << 8) | data[3]);
+        if (magic == 42) return ImageFormat::Tiff;
+        if (magic == 0x4F52) return ImageFormat::Orf;                     // "MMOR"
+    }
+    return ImageFormat::Unknown;
+}
+
+// 合并扩展名与魔数的结论：魔数优先；魔数只认出通用 TIFF 时保留扩展名给出的具体 RAW 类型
+constexpr ImageFormat ResolveFormat(ImageFormat byExtension, ImageFormat sniffed) {
+    if (sniffed == ImageFormat::Unknown) return byExtension;
+    if (sniffed == ImageFormat::Tiff && IsTiffBasedFormat(byExtension)) return byExtension;
+    return sniffed;
+}
+
+// 扩展名查表，sniff 为 true 时再读文件头校正；文件打不开时只用扩展名
+ImageFormat DetectImageFormat(const std::string& path, bool sniff = true);
+
+// 扫描用的扩展名过滤器：注册表内的扩展名查 64 位掩码，其余落到哈希集合
+class ExtensionFilter {
+public:
+    explicit ExtensionFilter(const std::vector<std::string>& extensions)
+        : all_(extensions.empty()), registered_(0) {
+        for (const auto& ext : extensions) {
+            int slot = ExtensionSlot(ext);
+            if (slot >= 0) {
+                registered_ |= uint64_t(1) << slot;
+            } else {
+                std::string lower = ext;
+                for (auto& c : lower) c = image_formats_detail::Lower(c);
+                others_.insert(std::move(lower));
+            }
+        }
+    }
+
+    bool MatchesAll() const { return all_; }
+
+    // ext 为带点的小写扩展名
+    bool Matches(const std::string& ext) const {
+        if (all_) return true;
+        int slot = ExtensionSlot(ext);
+        if (slot >= 0) return (registered_ >> slot) & 1;
+        return !others_.empty() && others_.count(ext) > 0;
+    }
+
+private:
+    bool all_;
+    uint64_t registered_;
+    std::unordered_set<std::string> others_;
+};
@@ -0,0 +1,342 @@
+#include "image_resize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QP_RESAMPLE_X64 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define QP_TARGET_SSE41
+#define QP_TARGET_AVX2
+#else
+#define QP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define QP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+void FitInside(int width, int height, int boxWidth, int boxHeight, int& outWidth, int& outHeight) {
+    double scale = std::min({double(boxWidth) / width, double(boxHeight) / height, 1.0});
+    outWidth = std::max(1, int(width * scale + 0.5));
+    outHeight = std::max(1, int(height * scale + 0.5));
+}
+
+namespace {
+
+constexpr int kWeightBits = 14;
+constexpr int kWeightOne = 1 << kWeightBits;
+constexpr int kWeightRound = 1 << (kWeightBits - 1);
+constexpr double kAreaMinRatio = 3.0;       // 缩小到 1/3 以下时 Lanczos 的大窗口不再带来可见差别
+
+// 每个目标位置对应一段连续源像素及其定点权重；权重按固定步长 taps 存放，count 之后补零
+struct WeightTable {
+    int taps = 0;
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int16_t> weights;
+
+    const int16_t* At(int i) const { return weights.data() + size_t(i) * taps; }
+};
+
+double Lanczos3(double x) {
+    x = std::fabs(x);
+    if (x < 1e-8) return 1.0;
+    if (x >= 3.0) return 0.0;
+    const double pi = 3.14159265358979323846;
+    return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+}
+
+// 浮点权重归一化为 14 位定点，舍入误差补到最大的一项上，保证和恰为 1
+void Quantize(const std::vector<double>& values, int16_t* out) {
+    double sum = 0;
+    for (double v : values) sum += v;
+    int total = 0;
+    size_t largest = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        out[i] = static_cast<int16_t>(std::lround(values[i] / sum * kWeightOne));
+        total += out[i];
+        if (values[i] > values[largest]) largest = i;
+    }
+    out[largest] = static_cast<int16_t>(out[largest] + kWeightOne - total);
+}
+
+WeightTable BuildWeights(int srcSize, int dstSize, bool area) {
+    std::vector<int> first(dstSize), last(dstSize);
+    std::vector<std::vector<double>> values(dstSize);
+    double ratio = double(srcSize) / dstSize;
+
+    for (int d = 0; d < dstSize; d++) {
+        if (area) {
+            double begin = d * ratio;
+            double end = begin + ratio;
+            first[d] = std::min(int(begin), srcSize - 1);
+            last[d] = std::max(std::min(int(std::ceil(end)), srcSize), first[d] + 1);
+            for (int s = first[d]; s < last[d]; s++) {
+                values[d].push_back(std::max(0.0, std::min<double>(s + 1, end) - std::max<double>(s, begin)));
+            }
+        } else {
+            // 缩小时按比例拉宽窗口，起低通作用
+            double scale = std::max(ratio, 1.0);
+            double support = 3.0 * scale;
+            double center = (d + 0.5) * ratio;
+            first[d] = std::max(int(center - support + 0.5), 0);
+            last[d] = std::max(std::min(int(center + support + 0.5), srcSize), first[d] + 1);
+            for (int s = first[d]; s < last[d]; s++) {
+                values[d].push_back(Lanczos3((s - center + 0.5) / scale));
+            }
+        }
+        if (std::all_of(values[d].begin(), values[d].end(), [](double v) { return v == 0; })) {
+            values[d].assign(values[d].size(), 1.0);
+        }
+    }
+
+    WeightTable table;
+    for (int d = 0; d < dstSize; d++) table.taps = std::max(table.taps, last[d] - first[d]);
+    table.first = std::move(first);
+    table.count.resize(dstSize);
+    table.weights.assign(size_t(dstSize) * table.taps, 0);
+    for (int d = 0; d < dstSize; d++) {
+        table.count[d] = static_cast<int>(values[d].size());
+        Quantize(values[d], table.weights.data() + size_t(d) * table.taps);
+    }
+    return table;
+}
+
+inline uint8_t Clamp8(int32_t v) {
+    v >>= kWeightBits;
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// ---- 标量内核 ----
+
+void HorizontalPixelScalar(const uint8_t* src, const int16_t* w, int count, int channels, uint8_t* dst) {
+    int32_t acc[4] = {kWeightRound, kWeightRound, kWeightRound, kWeightRound};
+    for (int k = 0; k < count; k++) {
+        const uint8_t* p = src + k * channels;
+        for (int c = 0; c < channels; c++) acc[c] += p[c] * w[k];
+    }
+    for (int c = 0; c < channels; c++) dst[c] = Clamp8(acc[c]);
+}
+
+void HorizontalScalar(const uint8_t* src, int srcWidth, uint8_t* dst, int channels, const WeightTable& t) {
+    (void)srcWidth;
+    for (size_t x = 0; x < t.first.size(); x++) {
+        HorizontalPixelScalar(src + size_t(t.first[x]) * channels, t.At(int(x)), t.count[x], channels,
+                              dst + x * channels);
+    }
+}
+
+void VerticalRange(const uint8_t* const* rows, const int16_t* w, int count, uint8_t* dst, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        int32_t acc = kWeightRound;
+        for (int k = 0; k < count; k++) acc += rows[k][i] * w[k];
+        dst[i] = Clamp8(acc);
+    }
+}
+
+void VerticalScalar(const uint8_t* const* rows, const int16_t* w, int count, uint8_t* dst, size_t bytes) {
+    VerticalRange(rows, w, count, dst, 0, bytes);
+}
+
+#ifdef QP_RESAMPLE_X64
+
+inline uint32_t Load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 每个像素占一个 4 x int32 寄存器；RGB 时多读的第 4 字节权重结果被丢弃，
+// 因此只在最后一个抽头之后还有源像素时走向量路径
+QP_TARGET_SSE41 void HorizontalSse41(const uint8_t* src, int srcWidth, uint8_t* dst, int channels,
+                                     const WeightTable& t) {
+    for (size_t x = 0; x < t.first.size(); x++) {
+        int first = t.first[x], count = t.count[x];
+        const int16_t* w = t.At(int(x));
+        const uint8_t* p = src + size_t(first) * channels;
+        if (channels == 3 && first + count >= srcWidth) {
+            HorizontalPixelScalar(p, w, count, channels, dst + x * channels);
+            continue;
+        }
+
+        __m128i acc = _mm_set1_epi32(kWeightRound);
+        for (int k = 0; k < count; k++) {
+            __m128i px = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(Load32(p + k * channels))));
+            acc = _mm_add_epi32(acc, _mm_mullo_epi32(px, _mm_set1_epi32(w[k])));
+        }
+        acc = _mm_srai_epi32(acc, kWeightBits);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(acc, acc), _mm_setzero_si128());
+        uint32_t out = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+        memcpy(dst + x * channels, &out, channels);
+    }
+}
+
+QP_TARGET_SSE41 void VerticalSse41(const uint8_t* const* rows, const int16_t* w, int count, uint8_t* dst, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i a0 = _mm_set1_epi32(kWeightRound), a1 = a0, a2 = a0, a3 = a0;
+        for (int k = 0; k < count; k++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+            __m128i wk = _mm_set1_epi32(w[k]);
+            a0 = _mm_add_epi32(a0, _mm_mullo_epi32(_mm_cvtepu8_epi32(v), wk));
+            a1 = _mm_add_epi32(a1, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)), wk));
+            a2 = _mm_add_epi32(a2, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8)), wk));
+            a3 = _mm_add_epi32(a3, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12)), wk));
+        }
+        __m128i lo = _mm_packs_epi32(_mm_srai_epi32(a0, kWeightBits), _mm_srai_epi32(a1, kWeightBits));
+        __m128i hi = _mm_packs_epi32(_mm_srai_epi32(a2, kWeightBits), _mm_srai_epi32(a3, kWeightBits));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    VerticalRange(rows, w, count, dst, i, bytes);
+}
+
+// 一次处理两个抽头：相邻两个像素展开到 8 x int32，高低两半各乘自己的权重，最后合并
+QP_TARGET_AVX2 void HorizontalAvx2(const uint8_t* src, int srcWidth, uint8_t* dst, int channels,
+                                   const WeightTable& t) {
+    // RGB 两个像素共 6 字节，补成 RGB0 RGB0
+    const __m128i rgbSpread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    for (size_t x = 0; x < t.first.size(); x++) {
+        int first = t.first[x], count = t.count[x];
+        const int16_t* w = t.At(int(x));
+        const uint8_t* p = src + size_t(first) * channels;
+        if (channels == 3 && first + count >= srcWidth) {
+            HorizontalPixelScalar(p, w, count, channels, dst + x * channels);
+            continue;
+        }
+
+        __m256i acc = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 2 <= count; k += 2) {
+            __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + k * channels));
+            if (channels == 3) pair = _mm_shuffle_epi8(pair, rgbSpread);
+            __m256i weights = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(w[k])),
+                                                      _mm_set1_epi32(w[k + 1]), 1);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(pair), weights));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_set1_epi32(kWeightRound));
+        if (k < count) {
+            __m128i px = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(Load32(p + k * channels))));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(px, _mm_set1_epi32(w[k])));
+        }
+        sum = _mm_srai_epi32(sum, kWeightBits);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum, sum), _mm_setzero_si128());
+        uint32_t out = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+        memcpy(dst + x * channels, &out, channels);
+    }
+}
+
+QP_TARGET_AVX2 void VerticalAvx2(const uint8_t* const* rows, const int16_t* w, int count, uint8_t* dst, size_t bytes) {
+    // packs/packus 在两个 128 位半区内分别交错，最后按 dword 重排回顺序
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i a0 = _mm256_set1_epi32(kWeightRound), a1 = a0, a2 = a0, a3 = a0;
+        for (int k = 0; k < count; k++) {
+            const uint8_t* r = rows[k] + i;
+            __m256i wk = _mm256_set1_epi32(w[k]);
+            a0 = _mm256_add_epi32(a0, _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r))), wk));
+            a1 = _mm256_add_epi32(a1, _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r + 8))), wk));
+            a2 = _mm256_add_epi32(a2, _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r + 16))), wk));
+            a3 = _mm256_add_epi32(a3, _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r + 24))), wk));
+        }
+        __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(a0, kWeightBits), _mm256_srai_epi32(a1, kWeightBits));
+        __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(a2, kWeightBits), _mm256_srai_epi32(a3, kWeightBits));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    VerticalRange(rows, w, count, dst, i, bytes);
+}
+
+#endif // QP_RESAMPLE_X64
+
+struct ResampleKernels {
+    void (*horizontal)(const uint8_t* src, int srcWidth, uint8_t* dst, int channels, const WeightTable& t);
+    void (*vertical)(const uint8_t* const* rows, const int16_t* w, int count, uint8_t* dst, size_t bytes);
+    const char* name;
+};
+
+const ResampleKernels& Kernels() {
+    static const ResampleKernels kernels = []() -> ResampleKernels {
+#ifdef QP_RESAMPLE_X64
+        if (CpuHasAvx2()) return {HorizontalAvx2, VerticalAvx2, "avx2"};
+        if (CpuHasSse41()) return {HorizontalSse41, VerticalSse41, "sse4.1"};
+#endif
+        return {HorizontalScalar, VerticalScalar, "scalar"};
+    }();
+    return kernels;
+}
+
+} // namespace
+
+bool Resample(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+              uint8_t* dst, int dstWidth, int dstHeight, ResampleFilter filter) {
+    if ((channels != 3 && channels != 4) || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return false;
+    }
+
+    auto useArea = [filter](int srcSize, int dstSize) {
+        if (filter == ResampleFilter::Auto) return srcSize >= dstSize * kAreaMinRatio;
+        return filter == ResampleFilter::Area;
+    };
+    WeightTable horizontal = BuildWeights(srcWidth, dstWidth, useArea(srcWidth, dstWidth));
+    WeightTable vertical = BuildWeights(srcHeight, dstHeight, useArea(srcHeight, dstHeight));
+    const ResampleKernels& kernels = Kernels();
+
+    // 横向只处理纵向权重实际用到的源行
+    int rowBegin = vertical.first.front();
+    int rowEnd = vertical.first.back() + vertical.count.back();
+    size_t srcRow = size_t(srcWidth) * channels;
+    size_t dstRow = size_t(dstWidth) * channels;
+    std::vector<uint8_t> temp(size_t(rowEnd - rowBegin) * dstRow);
+    for (int y = rowBegin; y < rowEnd; y++) {
+        kernels.horizontal(src + y * srcRow, srcWidth, temp.data() + (y - rowBegin) * dstRow, channels, horizontal);
+    }
+
+    std::vector<const uint8_t*> rows(vertical.taps);
+    for (int y = 0; y < dstHeight; y++) {
+        int first = vertical.first[y], count = vertical.count[y];
+        for (int k = 0; k < count; k++) rows[k] = temp.data() + size_t(first + k - rowBegin) * dstRow;
+        kernels.vertical(rows.data(), vertical.At(y), count, dst + y * dstRow, dstRow);
+    }
+    return true;
+}
+
+const char* ResampleImplementation() {
+    return Kernels().name;
+}
+
+void OrientPixels(const uint8_t* src, int width, int height, int channels, int orientation,
+                  std::vector<uint8_t>& dst, int& outWidth, int& outHeight) {
+    bool transpose = orientation >= 5 && orientation <= 8;
+    outWidth = transpose ? height : width;
+    outHeight = transpose ? width : height;
+    dst.resize(size_t(width) * height * channels);
+
+    for (int y = 0; y < outHeight; y++) {
+        for (int x = 0; x < outWidth; x++) {
+            // 目标 (x, y) 对应的源像素
+            int sx, sy;
+            switch (orientation) {
+                case 2: sx = width - 1 - x; sy = y; break;
+                case 3: sx = width - 1 - x; sy = height - 1 - y; break;
+                case 4: sx = x; sy = height - 1 - y; break;
+                case 5: sx = y; sy = x; break;
+                case 6: sx = y; sy = height - 1 - x; break;
+                case 7: sx = width - 1 - y; sy = height - 1 - x; break;
+                case 8: sx = width - 1 - y; sy = x; break;
+                default: sx = x; sy = y; break;
+            }
+            const uint8_t* p = src + (size_t(sy) * width + sx) * channels;
+            std::copy(p, p + channels, dst.data() + (size_t(y) * outWidth + x) * channels);
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 8 位交错像素（RGB/RGBA）的缩放与方向处理
+
+// 等比缩进 boxWidth x boxHeight，不放大
+void FitInside(int width, int height, int boxWidth, int boxHeight, int& outWidth, int& outHeight);
+
+enum class ResampleFilter {
+    Auto,       // 缩小比例不小于 3 时用面积平均，否则用 Lanczos-3
+    Area,       // 面积平均：每个目标像素取其覆盖源区域的均值，边缘按覆盖比例加权
+    Lanczos3,
+};
+
+// 可分离重采样：先横向后纵向，每个方向的权重表（14 位定点）按目标行/列预先计算一次。
+// x86 上运行时选择 AVX2 或 SSE4.1 内核，其他平台走标量实现，各内核输出逐字节一致。
+// channels 为 3 或 4；dst 需容纳 dstWidth * dstHeight * channels 字节
+bool Resample(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+              uint8_t* dst, int dstWidth, int dstHeight, ResampleFilter filter = ResampleFilter::Auto);
+
+// 当前使用的实现："avx2"、"sse4.1" 或 "scalar"
+const char* ResampleImplementation();
+
+// 按 EXIF Orientation（1-8）重排像素得到正向图像；5-8 宽高互换
+void OrientPixels(const uint8_t* src, int width, int height, int channels, int orientation,
+                  std::vector<uint8_t>& dst, int& outWidth, int& outHeight);
@@ -0,0 +1,550 @@
+#include "jpeg_codec.h"
+
+#ifdef QP_HAVE_LIBJPEG
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <jpeglib.h>
+
+namespace {
+
+// libjpeg 出错时通过 longjmp 跳回，不能让它调用 exit()
+struct ErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void OnJpegError(j_common_ptr cinfo) {
+    ErrorManager* err = reinterpret_cast<ErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->message);
+    longjmp(err->jump, 1);
+}
+
+void OnJpegMessage(j_common_ptr, int) {}
+
+// 压缩输出直接写入调用方的 vector，缓冲由 vector 自己管理：成功、出错都无需另行释放，
+// 不依赖 jpeg_mem_dest 内部在 term_destination 时才回写指针的行为
+struct VectorDestination {
+    jpeg_destination_mgr pub;
+    std::vector<uint8_t>* out;
+    size_t initialSize;
+};
+
+void InitVectorDestination(j_compress_ptr cinfo) {
+    VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    dest->out->resize(std::max<size_t>(dest->initialSize, 4096));
+    dest->pub.next_output_byte = dest->out->data();
+    dest->pub.free_in_buffer = dest->out->size();
+}
+
+// libjpeg 约定调用时缓冲已整块写满
+boolean GrowVectorDestination(j_compress_ptr cinfo) {
+    VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    size_t used = dest->out->size();
+    dest->out->resize(used * 2);
+    dest->pub.next_output_byte = dest->out->data() + used;
+    dest->pub.free_in_buffer = dest->out->size() - used;
+    return TRUE;
+}
+
+void TermVectorDestination(j_compress_ptr cinfo) {
+    VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+}
+
+void SetVectorDestination(j_compress_ptr cinfo, VectorDestination* dest,
+                          std::vector<uint8_t>* out, size_t initialSize) {
+    dest->pub.init_destination = InitVectorDestination;
+    dest->pub.empty_output_buffer = GrowVectorDestination;
+    dest->pub.term_destination = TermVectorDestination;
+    dest->out = out;
+    dest->initialSize = initialSize;
+    cinfo->dest = &dest->pub;
+}
+
+// 各方向下目标块 (dx, dy) 对应的源块，以及块内系数的重排规则
+struct Transform {
+    bool transpose;     // 行列互换（5-8）
+    bool mirrorX;       // 源图水平方向被反向读取，需要按 MCU 裁边
+    bool mirrorY;
+};
+
+Transform TransformFor(int orientation) {
+    switch (orientation) {
+        case 2: return {false, true, false};    // 水平翻转
+        case 3: return {false, true, true};     // 旋转 180°
+        case 4: return {false, false, true};    // 垂直翻转
+        case 5: return {true, false, false};    // 主对角线转置
+        case 6: return {true, false, true};     // 顺时针 90°
+        case 7: return {true, true, true};      // 副对角线转置
+        default: return {true, true, false};    // 8：顺时针 270°
+    }
+}
+
+// 单个 8x8 系数块：k = 垂直频率 * 8 + 水平频率。转置交换两轴；
+// 目标的水平方向被翻转时奇数水平频率取反，垂直方向同理
+void TransformBlock(const JCOEF* in, JCOEF* out, int orientation) {
+    for (int r = 0; r < DCTSIZE; r++) {
+        for (int c = 0; c < DCTSIZE; c++) {
+            JCOEF v;
+            bool negate;
+            switch (orientation) {
+                case 2: v = in[r * DCTSIZE + c]; negate = (c & 1); break;
+                case 3: v = in[r * DCTSIZE + c]; negate = ((r + c) & 1); break;
+                case 4: v = in[r * DCTSIZE + c]; negate = (r & 1); break;
+                case 5: v = in[c * DCTSIZE + r]; negate = false; break;
+                case 6: v = in[c * DCTSIZE + r]; negate = (c & 1); break;
+                case 7: v = in[c * DCTSIZE + r]; negate = ((r + c) & 1); break;
+                default: v = in[c * DCTSIZE + r]; negate = (r & 1); break;
+            }
+            out[r * DCTSIZE + c] = negate ? static_cast<JCOEF>(-v) : v;
+        }
+    }
+}
+
+JDIMENSION RoundUp(JDIMENSION value, JDIMENSION multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+JDIMENSION CeilDiv(JDIMENSION value, JDIMENSION divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+// setjmp 所在帧里只放 C 结构，避免 longjmp 跳过析构
+struct TransformJob {
+    const uint8_t* data;
+    size_t size;
+    int orientation;
+    std::vector<uint8_t>* output;   // 由调用方持有，不在 setjmp 帧内
+    VectorDestination dest;
+    int width;
+    int height;
+    ErrorManager err;       // 解码、编码两端共用
+    jpeg_decompress_struct src;
+    jpeg_compress_struct dst;
+};
+
+bool RunTransform(TransformJob* job) {
+    jpeg_decompress_struct* src = &job->src;
+    jpeg_compress_struct* dst = &job->dst;
+
+    src->err = jpeg_std_error(&job->err.pub);
+    dst->err = &job->err.pub;
+    job->err.pub.error_exit = OnJpegError;
+    job->err.pub.emit_message = OnJpegMessage;
+
+    if (setjmp(job->err.jump)) {
+        return false;
+    }
+
+    jpeg_create_decompress(src);
+    jpeg_create_compress(dst);
+    jpeg_mem_src(src, const_cast<unsigned char*>(job->data), static_cast<unsigned long>(job->size));
+    jpeg_read_header(src, TRUE);
+
+    const Transform t = TransformFor(job->orientation);
+    const JDIMENSION mcuWidth = DCTSIZE * src->max_h_samp_factor;
+    const JDIMENSION mcuHeight = DCTSIZE * src->max_v_samp_factor;
+
+    // 被反向读取的方向上，末尾不完整的 MCU 无法原样搬到图像起点，按 jpegtran -trim 的做法裁掉
+    JDIMENSION srcWidth = src->image_width;
+    JDIMENSION srcHeight = src->image_height;
+    if (t.mirrorX && srcWidth >= mcuWidth) srcWidth = srcWidth / mcuWidth * mcuWidth;
+    if (t.mirrorY && srcHeight >= mcuHeight) srcHeight = srcHeight / mcuHeight * mcuHeight;
+
+    // 目标系数数组需在 jpeg_read_coefficients 实现虚拟数组之前申请
+    jvirt_barray_ptr dstArrays[MAX_COMPONENTS];
+    JDIMENSION srcBlocksW[MAX_COMPONENTS];
+    JDIMENSION srcBlocksH[MAX_COMPONENTS];
+    for (int ci = 0; ci < src->num_components; ci++) {
+        jpeg_component_info* comp = &src->comp_info[ci];
+        srcBlocksW[ci] = CeilDiv(srcWidth * comp->h_samp_factor, mcuWidth);
+        srcBlocksH[ci] = CeilDiv(srcHeight * comp->v_samp_factor, mcuHeight);
+
+        int dstH = t.transpose ? comp->v_samp_factor : comp->h_samp_factor;
+        int dstV = t.transpose ? comp->h_samp_factor : comp->v_samp_factor;
+        JDIMENSION blocksW = t.transpose ? srcBlocksH[ci] : srcBlocksW[ci];
+        JDIMENSION blocksH = t.transpose ? srcBlocksW[ci] : srcBlocksH[ci];
+        dstArrays[ci] = (*src->mem->request_virt_barray)(
+            reinterpret_cast<j_common_ptr>(src), JPOOL_IMAGE, TRUE,
+            RoundUp(blocksW, dstH), RoundUp(blocksH, dstV), static_cast<JDIMENSION>(dstV));
+    }
+
+    jvirt_barray_ptr* srcArrays = jpeg_read_coefficients(src);
+
+    jpeg_copy_critical_parameters(src, dst);
+    dst->image_width = t.transpose ? srcHeight : srcWidth;
+    dst->image_height = t.transpose ? srcWidth : srcHeight;
+    dst->optimize_coding = TRUE;
+    if (t.transpose) {
+        for (int ci = 0; ci < dst->num_components; ci++) {
+            jpeg_component_info* comp = &dst->comp_info[ci];
+            int h = comp->h_samp_factor;
+            comp->h_samp_factor = comp->v_samp_factor;
+            comp->v_samp_factor = h;
+        }
+        // 系数转置后对应的量化步长也随之转置
+        for (int i = 0; i < NUM_QUANT_TBLS; i++) {
+            JQUANT_TBL* table = dst->quant_tbl_ptrs[i];
+            if (!table) continue;
+            for (int r = 0; r < DCTSIZE; r++) {
+                for (int c = r + 1; c < DCTSIZE; c++) {
+                    UINT16 tmp = table->quantval[r * DCTSIZE + c];
+                    table->quantval[r * DCTSIZE + c] = table->quantval[c * DCTSIZE + r];
+                    table->quantval[c * DCTSIZE + r] = tmp;
+                }
+            }
+        }
+    }
+
+    j_common_ptr common = reinterpret_cast<j_common_ptr>(src);
+    for (int ci = 0; ci < src->num_components; ci++) {
+        jpeg_component_info* comp = &src->comp_info[ci];
+        int dstH = t.transpose ? comp->v_samp_factor : comp->h_samp_factor;
+        int dstV = t.transpose ? comp->h_samp_factor : comp->v_samp_factor;
+        JDIMENSION blocksW = RoundUp(t.transpose ? srcBlocksH[ci] : srcBlocksW[ci], dstH);
+        JDIMENSION blocksH = RoundUp(t.transpose ? srcBlocksW[ci] : srcBlocksH[ci], dstV);
+        JDIMENSION lastX = srcBlocksW[ci] - 1;
+        JDIMENSION lastY = srcBlocksH[ci] - 1;
+
+        for (JDIMENSION dy = 0; dy < blocksH; dy++) {
+            JBLOCKROW out = (*src->mem->access_virt_barray)(common, dstArrays[ci], dy, 1, TRUE)[0];
+            for (JDIMENSION dx = 0; dx < blocksW; dx++) {
+                // 目标块在源图中的位置；转置时两轴互换，反向轴从末尾数起
+                JDIMENSION sx = t.transpose ? dy : dx;
+                JDIMENSION sy = t.transpose ? dx : dy;
+                if (sx > lastX || sy > lastY) {
+                    memset(out[dx], 0, sizeof(JBLOCK));
+                    continue;
+                }
+                if (t.mirrorX) sx = lastX - sx;
+                if (t.mirrorY) sy = lastY - sy;
+                JBLOCKROW in = (*src->mem->access_virt_barray)(common, srcArrays[ci], sy, 1, FALSE)[0];
+                TransformBlock(in[sx], out[dx], job->orientation);
+            }
+        }
+    }
+
+    // 转正不改变熵编码数据量级，按输入大小预留
+    SetVectorDestination(dst, &job->dest, job->output, job->size + 1024);
+    jpeg_write_coefficients(dst, dstArrays);
+    jpeg_finish_compress(dst);
+    jpeg_finish_decompress(src);
+
+    job->width = static_cast<int>(dst->image_width);
+    job->height = static_cast<int>(dst->image_height);
+    return true;
+}
+
+// 解码分两段：先读文件头定下缩放与输出尺寸，调用方按尺寸分配好像素缓冲后再读扫描行。
+// 结构体跨图片复用，libjpeg 对象只在第一次使用时创建
+struct DecodeJob {
+    const uint8_t* data;
+    size_t size;
+    int boxWidth;
+    int boxHeight;
+    J_COLOR_SPACE colorSpace;
+    uint8_t* pixels;
+    bool created;
+    ErrorManager err;
+    jpeg_decompress_struct src;
+};
+
+bool StartDecode(DecodeJob* job) {
+    jpeg_decompress_struct* src = &job->src;
+    if (setjmp(job->err.jump)) {
+        return false;
+    }
+
+    if (!job->created) {
+        src->err = jpeg_std_error(&job->err.pub);
+        job->err.pub.error_exit = OnJpegError;
+        job->err.pub.emit_message = OnJpegMessage;
+        jpeg_create_decompress(src);
+        job->created = true;
+    }
+
+    // 读文件头会把缩放与输出色彩空间重置为默认值，上一张图的设置不会残留
+    jpeg_mem_src(src, const_cast<unsigned char*>(job->data), static_cast<unsigned long>(job->size));
+    jpeg_read_header(src, TRUE);
+    src->out_color_space = job->colorSpace;
+
+    if (job->boxWidth > 0 && job->boxHeight > 0) {
+        double scale = std::min({double(job->boxWidth) / src->image_width,
+                                 double(job->boxHeight) / src->image_height, 1.0});
+        JDIMENSION targetW = std::max<JDIMENSION>(1, JDIMENSION(src->image_width * scale + 0.5));
+        JDIMENSION targetH = std::max<JDIMENSION>(1, JDIMENSION(src->image_height * scale + 0.5));
+        for (unsigned denom = 8; denom >= 2; denom /= 2) {
+            if (CeilDiv(src->image_width, denom) >= targetW && CeilDiv(src->image_height, denom) >= targetH) {
+                src->scale_num = 1;
+                src->scale_denom = denom;
+                break;
+            }
+        }
+    }
+
+    jpeg_start_decompress(src);
+    return true;
+}
+
+bool FinishDecode(DecodeJob* job) {
+    jpeg_decompress_struct* src = &job->src;
+    if (setjmp(job->err.jump)) {
+        return false;
+    }
+
+    size_t stride = size_t(src->output_width) * src->output_components;
+    while (src->output_scanline < src->output_height) {
+        JSAMPROW rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = job->pixels + std::min<size_t>(src->output_scanline + i, src->output_height - 1) * stride;
+        }
+        jpeg_read_scanlines(src, rows, std::min<JDIMENSION>(4, src->output_height - src->output_scanline));
+    }
+    jpeg_finish_decompress(src);
+    return true;
+}
+
+struct EncodeJob {
+    const uint8_t* pixels;
+    int width;
+    int height;
+    int quality;
+    std::vector<uint8_t>* output;   // 由调用方持有，不在 setjmp 帧内
+    VectorDestination dest;
+    bool created;
+    ErrorManager err;
+    jpeg_compress_struct dst;
+};
+
+bool RunEncode(EncodeJob* job) {
+    jpeg_compress_struct* dst = &job->dst;
+    if (setjmp(job->err.jump)) {
+        return false;
+    }
+
+    if (!job->created) {
+        dst->err = jpeg_std_error(&job->err.pub);
+        job->err.pub.error_exit = OnJpegError;
+        job->err.pub.emit_message = OnJpegMessage;
+        jpeg_create_compress(dst);
+        job->created = true;
+    }
+
+    // 缩略图通常压到原始像素的 1/10 以内
+    SetVectorDestination(dst, &job->dest, job->output, size_t(job->width) * job->height * 3 / 10);
+    dst->image_width = static_cast<JDIMENSION>(job->width);
+    dst->image_height = static_cast<JDIMENSION>(job->height);
+    dst->input_components = 3;
+    dst->in_color_space = JCS_RGB;
+    jpeg_set_defaults(dst);
+    jpeg_set_quality(dst, std::max(1, std::min(job->quality, 100)), TRUE);
+    dst->optimize_coding = TRUE;
+    jpeg_start_compress(dst, TRUE);
+
+    size_t stride = size_t(job->width) * 3;
+    while (dst->next_scanline < dst->image_height) {
+        JSAMPROW row = const_cast<JSAMPROW>(job->pixels + dst->next_scanline * stride);
+        jpeg_write_scanlines(dst, &row, 1);
+    }
+    jpeg_finish_compress(dst);
+    return true;
+}
+
+} // namespace
+
+bool JpegCodecAvailable() {
+    return true;
+}
+
+struct JpegDecoder::State {
+    DecodeJob job;
+};
+
+JpegDecoder::JpegDecoder()
+    : state_(static_cast<State*>(calloc(1, sizeof(State)))) {}
+
+JpegDecoder::~JpegDecoder() {
+    if (state_ && state_->job.created) {
+        jpeg_destroy_decompress(&state_->job.src);
+    }
+    free(state_);
+}
+
+bool JpegDecoder::Decode(const uint8_t* data, size_t size, int boxWidth, int boxHeight,
+                         DecodedImage& image, std::string& error, PixelLayout layout) {
+    if (!state_) {
+        error = "Out of memory";
+        return false;
+    }
+    DecodeJob* job = &state_->job;
+    switch (layout) {
+#ifdef JCS_ALPHA_EXTENSIONS
+        case PixelLayout::Rgba: job->colorSpace = JCS_EXT_RGBA; break;
+        case PixelLayout::Bgra: job->colorSpace = JCS_EXT_BGRA; break;
+#else
+        case PixelLayout::Rgba:
+        case PixelLayout::Bgra:
+            error = "RGBA/BGRA output requires libjpeg-turbo";
+            return false;
+#endif
+        default: job->colorSpace = JCS_RGB; break;
+    }
+    job->data = data;
+    job->size = size;
+    job->boxWidth = boxWidth;
+    job->boxHeight = boxHeight;
+    job->pixels = nullptr;
+
+    bool ok = StartDecode(job);
+    if (ok) {
+        image.width = static_cast<int>(job->src.output_width);
+        image.height = static_cast<int>(job->src.output_height);
+        image.layout = layout;
+        image.pixels.resize(size_t(image.width) * image.height * job->src.output_components);
+        job->pixels = image.pixels.data();
+        ok = FinishDecode(job);
+    }
+    if (!ok) {
+        error = job->err.message;
+        image.pixels.clear();
+        // 出错后复位到可再次读文件头的状态，对象本身继续复用
+        if (job->created) {
+            jpeg_abort_decompress(&job->src);
+        }
+    }
+    return ok;
+}
+
+struct JpegEncoder::State {
+    EncodeJob job;
+};
+
+JpegEncoder::JpegEncoder()
+    : state_(static_cast<State*>(calloc(1, sizeof(State)))) {}
+
+JpegEncoder::~JpegEncoder() {
+    if (state_ && state_->job.created) {
+        jpeg_destroy_compress(&state_->job.dst);
+    }
+    free(state_);
+}
+
+bool JpegEncoder::Encode(const uint8_t* pixels, int width, int height, int quality,
+                         std::vector<uint8_t>& out, std::string& error) {
+    if (!state_) {
+        error = "Out of memory";
+        return false;
+    }
+    EncodeJob* job = &state_->job;
+    job->pixels = pixels;
+    job->width = width;
+    job->height = height;
+    job->quality = quality;
+    job->output = &out;
+
+    bool ok = RunEncode(job);
+    if (!ok) {
+        error = job->err.message;
+        out.clear();
+        if (job->created) {
+            jpeg_abort_compress(&job->dst);
+        }
+    }
+    job->output = nullptr;
+    return ok;
+}
+
+bool DecodeJpeg(const uint8_t* data, size_t size, int boxWidth, int boxHeight,
+                DecodedImage& image, std::string& error, PixelLayout layout) {
+    JpegDecoder decoder;
+    return decoder.Decode(data, size, boxWidth, boxHeight, image, error, layout);
+}
+
+bool EncodeJpeg(const uint8_t* pixels, int width, int height, int quality,
+                std::vector<uint8_t>& out, std::string& error) {
+    JpegEncoder encoder;
+    return encoder.Encode(pixels, width, height, quality, out, error);
+}
+
+bool TransformJpeg(const uint8_t* data, size_t size, int orientation,
+                   std::vector<uint8_t>& out, int& width, int& height, std::string& error) {
+    if (orientation < 2 || orientation > 8) {
+        error = "Unsupported orientation";
+        return false;
+    }
+
+    TransformJob* job = static_cast<TransformJob*>(calloc(1, sizeof(TransformJob)));
+    if (!job) {
+        error = "Out of memory";
+        return false;
+    }
+    job->data = data;
+    job->size = size;
+    job->orientation = orientation;
+    job->output = &out;
+
+    bool ok = RunTransform(job);
+    if (ok) {
+        width = job->width;
+        height = job->height;
+    } else {
+        error = job->err.message;
+        out.clear();
+    }
+
+    jpeg_destroy_compress(&job->dst);
+    jpeg_destroy_decompress(&job->src);
+    free(job);
+    return ok;
+}
+
+#else
+
+bool JpegCodecAvailable() {
+    return false;
+}
+
+bool TransformJpeg(const uint8_t*, size_t, int, std::vector<uint8_t>&, int&, int&, std::string& error) {
+    error = "libjpeg not available";
+    return false;
+}
+
+bool DecodeJpeg(const uint8_t*, size_t, int, int, DecodedImage&, std::string& error, PixelLayout) {
+    error = "libjpeg not available";
+    return false;
+}
+
+bool EncodeJpeg(const uint8_t*, int, int, int, std::vector<uint8_t>&, std::string& error) {
+    error = "libjpeg not available";
+    return false;
+}
+
+struct JpegDecoder::State {};
+
+JpegDecoder::JpegDecoder() : state_(nullptr) {}
+
+JpegDecoder::~JpegDecoder() {}
+
+bool JpegDecoder::Decode(const uint8_t*, size_t, int, int, DecodedImage&, std::string& error, PixelLayout) {
+    error = "libjpeg not available";
+    return false;
+}
+
+struct JpegEncoder::State {};
+
+JpegEncoder::JpegEncoder() : state_(nullptr) {}
+
+JpegEncoder::~JpegEncoder() {}
+
+bool JpegEncoder::Encode(const uint8_t*, int, int, int, std::vector<uint8_t>&, std::string& error) {
+    error = "libjpeg not available";
+    return false;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// libjpeg(-turbo) 封装：binding.gyp 默认通过 find_libjpeg.js 找到库并定义 QP_HAVE_LIBJPEG；
+// 显式关闭或找不到时各函数直接返回失败，调用方退回原样透传。
+
+bool JpegCodecAvailable();
+
+// 按 EXIF Orientation（2-8）在 DCT 域无损旋转/翻转 JPEG，等同 jpegtran -rotate/-flip/-transpose -trim：
+// 只重排系数块，不解码也不重新量化；翻转方向上不足一个 MCU 的边缘会被裁掉。
+// 输出不带 EXIF，width/height 为变换后的尺寸。
+bool TransformJpeg(const uint8_t* data, size_t size, int orientation,
+                   std::vector<uint8_t>& out, int& width, int& height, std::string& error);
+
+// 解码输出的像素排列。带 alpha 的两种由 libjpeg-turbo 直接输出，alpha 恒为 255，
+// JPEG 不透明，预乘与否结果相同，可直接交给 ImageData / createImageBitmap
+enum class PixelLayout {
+    Rgb,
+    Rgba,
+    Bgra,
+};
+
+inline int PixelChannels(PixelLayout layout) {
+    return layout == PixelLayout::Rgb ? 3 : 4;
+}
+
+// 解码结果：按 layout 紧密排列的 8 位像素
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    PixelLayout layout = PixelLayout::Rgb;
+    std::vector<uint8_t> pixels;
+};
+
+// 解码为 layout 指定的排列。boxWidth/boxHeight 大于 0 时用 libjpeg 的缩放 IDCT（1/2、1/4、1/8），
+// 取仍能覆盖“等比缩进该框”目标尺寸的最大缩小倍数，剩下的缩放交给重采样
+bool DecodeJpeg(const uint8_t* data, size_t size, int boxWidth, int boxHeight,
+                DecodedImage& image, std::string& error, PixelLayout layout = PixelLayout::Rgb);
+
+// RGB 编码为基线 JPEG（4:2:0，优化哈夫曼表）
+bool EncodeJpeg(const uint8_t* pixels, int width, int height, int quality,
+                std::vector<uint8_t>& out, std::string& error);
+
+// 可复用的解码器：libjpeg 对象只创建一次，连续处理多张图时省去每张的创建/销毁与内存池分配。
+// 非线程安全，每个工作线程各持一个
+class JpegDecoder {
+public:
+    JpegDecoder();
+    ~JpegDecoder();
+    JpegDecoder(const JpegDecoder&) = delete;
+    JpegDecoder& operator=(const JpegDecoder&) = delete;
+
+    // 同 DecodeJpeg；image.pixels 已有的容量会被复用
+    bool Decode(const uint8_t* data, size_t size, int boxWidth, int boxHeight,
+                DecodedImage& image, std::string& error, PixelLayout layout = PixelLayout::Rgb);
+
+private:
+    struct State;
+    State* state_;
+};
+
+// 可复用的编码器，用法同 JpegDecoder
+class JpegEncoder {
+public:
+    JpegEncoder();
+    ~JpegEncoder();
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+    // 同 EncodeJpeg
+    bool Encode(const uint8_t* pixels, int width, int height, int quality,
+                std::vector<uint8_t>& out, std::string& error);
+
+private:
+    struct State;
+    State* state_;
+};
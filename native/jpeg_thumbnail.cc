@@ -0,0 +1,170 @@
+#include <napi.h>
+#include <string>
+#include <vector>
+
+#include "external_buffer.h"
+#include "image_resize.h"
+#include "jpeg_codec.h"
+#include "jpeg_thumbnail.h"
+#include "preview_locator.h"
+
+namespace {
+
+// 每个暂存缓冲保留的容量上限
+const size_t kScratchLimit = 16 * 1024 * 1024;
+
+void TrimBuffer(std::vector<uint8_t>& buffer) {
+    if (buffer.capacity() > kScratchLimit) {
+        std::vector<uint8_t>().swap(buffer);
+    }
+}
+
+} // namespace
+
+const std::vector<uint8_t>* ThumbnailContext::Render(const uint8_t* data, size_t size, int maxWidth, int maxHeight,
+                                                     PixelLayout layout, int& width, int& height, std::string& error) {
+    // 输出不带 EXIF，方向在像素上处理；转置方向先按交换后的框缩放
+    MemorySource memory(data, size);
+    int orientation = ReadJpegOrientation(memory, 0, size);
+    bool transpose = orientation >= 5;
+    int boxWidth = transpose ? maxHeight : maxWidth;
+    int boxHeight = transpose ? maxWidth : maxHeight;
+    
+    // 缩放 IDCT 完成粗缩小，重采样补足剩余比例
+    if (!decoder_.Decode(data, size, boxWidth, boxHeight, decoded_, error, layout)) {
+        return nullptr;
+    }
+    
+    int channels = PixelChannels(layout);
+    FitInside(decoded_.width, decoded_.height, boxWidth, boxHeight, width, height);
+    const std::vector<uint8_t>* pixels = &decoded_.pixels;
+    if (width != decoded_.width || height != decoded_.height) {
+        resized_.resize(size_t(width) * height * channels);
+        Resample(decoded_.pixels.data(), decoded_.width, decoded_.height, channels, resized_.data(), width, height);
+        pixels = &resized_;
+    }
+    
+    if (orientation > 1) {
+        OrientPixels(pixels->data(), width, height, channels, orientation, oriented_, width, height);
+        pixels = &oriented_;
+    }
+    return pixels;
+}
+
+bool ThumbnailContext::Make(const uint8_t* data, size_t size, int maxWidth, int maxHeight, int quality,
+                            std::vector<uint8_t>& out, int& width, int& height, std::string& error) {
+    const std::vector<uint8_t>* pixels = Render(data, size, maxWidth, maxHeight, PixelLayout::Rgb, width, height, error);
+    return pixels && encoder_.Encode(pixels->data(), width, height, quality, out, error);
+}
+
+bool ThumbnailContext::MakePixels(const uint8_t* data, size_t size, int maxWidth, int maxHeight, PixelLayout layout,
+                                  std::vector<uint8_t>& out, int& width, int& height, std::string& error) {
+    const std::vector<uint8_t>* pixels = Render(data, size, maxWidth, maxHeight, layout, width, height, error);
+    if (!pixels) {
+        return false;
+    }
+    out.assign(pixels->begin(), pixels->end());
+    return true;
+}
+
+void ThumbnailContext::Trim() {
+    TrimBuffer(decoded_.pixels);
+    TrimBuffer(resized_);
+    TrimBuffer(oriented_);
+    TrimBuffer(file_);
+}
+
+ThumbnailContext& ThumbnailContext::ForThread() {
+    thread_local ThumbnailContext context;
+    return context;
+}
+
+bool MakeJpegThumbnail(const uint8_t* data, size_t size, int maxWidth, int maxHeight, int quality,
+                       std::vector<uint8_t>& out, int& width, int& height, std::string& error) {
+    ThumbnailContext& context = ThumbnailContext::ForThread();
+    bool ok = context.Make(data, size, maxWidth, maxHeight, quality, out, width, height, error);
+    context.Trim();
+    return ok;
+}
+
+class JpegResizeWorker : public Napi::AsyncWorker {
+public:
+    JpegResizeWorker(Napi::Env& env, Napi::Buffer<uint8_t> input, int maxWidth, int maxHeight, int quality)
+        : Napi::AsyncWorker(env),
+          inputRef_(Napi::Persistent(static_cast<Napi::Object>(input))),
+          data_(input.Data()),
+          size_(input.Length()),
+          maxWidth_(maxWidth),
+          maxHeight_(maxHeight),
+          quality_(quality),
+          width_(0),
+          height_(0),
+          deferred_(Napi::Promise::Deferred::New(env)) {}
+    
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute() {
+        if (!MakeJpegThumbnail(data_, size_, maxWidth_, maxHeight_, quality_, output_, width_, height_, error_)) {
+            output_.clear();
+        }
+    }
+    
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("success", Napi::Boolean::New(env, error_.empty()));
+        obj.Set("width", Napi::Number::New(env, width_));
+        obj.Set("height", Napi::Number::New(env, height_));
+        if (error_.empty()) {
+            obj.Set("data", ExternalBuffer(env, std::move(output_)));
+        } else {
+            obj.Set("error", Napi::String::New(env, error_));
+        }
+        inputRef_.Reset();
+        deferred_.Resolve(obj);
+    }
+    
+    void OnError(const Napi::Error& e) {
+        inputRef_.Reset();
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    // 工作线程直接读 JS Buffer 的内存，持有引用防止其被回收
+    Napi::ObjectReference inputRef_;
+    const uint8_t* data_;
+    size_t size_;
+    int maxWidth_;
+    int maxHeight_;
+    int quality_;
+    int width_;
+    int height_;
+    std::vector<uint8_t> output_;
+    std::string error_;
+    Napi::Promise::Deferred deferred_;
+};
+
+// resizeJpeg(buffer, { maxWidth, maxHeight, quality })
+Napi::Value ResizeJpeg(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsBuffer()) {
+        Napi::TypeError::New(env, "Expected JPEG buffer").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    int maxWidth = 2000;
+    int maxHeight = 2000;
+    int quality = 85;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("maxWidth")) maxWidth = options.Get("maxWidth").As<Napi::Number>().Int32Value();
+        if (options.Has("maxHeight")) maxHeight = options.Get("maxHeight").As<Napi::Number>().Int32Value();
+        if (options.Has("quality")) quality = options.Get("quality").As<Napi::Number>().Int32Value();
+    }
+    
+    JpegResizeWorker* worker = new JpegResizeWorker(env, info[0].As<Napi::Buffer<uint8_t>>(), maxWidth, maxHeight, quality);
+    worker->Queue();
+    return worker->GetPromise();
+}
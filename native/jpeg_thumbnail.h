@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jpeg_codec.h"
+
+// JPEG 缩略图流水线：缩放 IDCT 解码 → 重采样到框内 → 按 EXIF 方向转正 → 以 quality 编码。
+// 需要 libjpeg（QP_HAVE_LIBJPEG），否则返回 false
+bool MakeJpegThumbnail(const uint8_t* data, size_t size, int maxWidth, int maxHeight, int quality,
+                       std::vector<uint8_t>& out, int& width, int& height, std::string& error);
+
+// 流水线的可复用上下文：解码器、编码器与各级中间缓冲跨图片保留，批量生成时每个工作线程一份
+class ThumbnailContext {
+public:
+    // 同 MakeJpegThumbnail
+    bool Make(const uint8_t* data, size_t size, int maxWidth, int maxHeight, int quality,
+              std::vector<uint8_t>& out, int& width, int& height, std::string& error);
+
+    // 同一流水线但不重新编码，直接输出转正后的像素（layout 为 Rgba 或 Bgra），
+    // 省掉一次编码和渲染端的一次解码
+    bool MakePixels(const uint8_t* data, size_t size, int maxWidth, int maxHeight, PixelLayout layout,
+                    std::vector<uint8_t>& out, int& width, int& height, std::string& error);
+
+    // 读入源文件用的暂存缓冲
+    std::vector<uint8_t>& FileBuffer() { return file_; }
+
+    // 一张图处理完后调用：偶发的超大图留下的缓冲超过上限就释放，不长期占着
+    void Trim();
+
+    // 当前线程的上下文，线程退出时释放
+    static ThumbnailContext& ForThread();
+
+private:
+    // 解码、缩放、转正，返回指向内部缓冲之一的像素
+    const std::vector<uint8_t>* Render(const uint8_t* data, size_t size, int maxWidth, int maxHeight,
+                                       PixelLayout layout, int& width, int& height, std::string& error);
+
+    JpegDecoder decoder_;
+    JpegEncoder encoder_;
+    DecodedImage decoded_;
+    std::vector<uint8_t> resized_;
+    std::vector<uint8_t> oriented_;
+    std::vector<uint8_t> file_;
+};
@@ -0,0 +1,159 @@
+#include "marker_scan.h"
+
+#include <cstring>
+
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QP_MARKER_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define QP_TARGET_AVX2
+#else
+#define QP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+size_t FindSoiScalar(const uint8_t* data, size_t size, size_t from) {
+    if (size < 3) return size;
+    for (size_t i = from; i + 2 < size; i++) {
+        // memchr 在各平台 libc 中本身是向量化的
+        const void* hit = memchr(data + i, 0xFF, size - 2 - i);
+        if (!hit) break;
+        i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        if (data[i + 1] == 0xD8 && data[i + 2] == 0xFF) return i;
+    }
+    return size;
+}
+
+size_t FindEntropyScalar(const uint8_t* data, size_t size, size_t from) {
+    if (size < 2) return size;
+    for (size_t i = from; i + 1 < size; i++) {
+        const void* hit = memchr(data + i, 0xFF, size - 1 - i);
+        if (!hit) break;
+        i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        uint8_t next = data[i + 1];
+        if (next != 0x00 && next != 0xFF) return i;
+    }
+    return size;
+}
+
+#ifdef QP_MARKER_X64
+
+inline unsigned LowestBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// x86-64 基线即包含 SSE2，无需检测
+size_t FindSoiSse2(const uint8_t* data, size_t size) {
+    const __m128i ff = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i d8 = _mm_set1_epi8(static_cast<char>(0xD8));
+    size_t i = 0;
+    for (; i + 16 + 2 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2));
+        __m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, ff), _mm_cmpeq_epi8(b, d8)),
+                                    _mm_cmpeq_epi8(c, ff));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask) return i + LowestBit(mask);
+    }
+    return FindSoiScalar(data, size, i);
+}
+
+size_t FindEntropySse2(const uint8_t* data, size_t size) {
+    const __m128i ff = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 + 1 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        __m128i skip = _mm_or_si128(_mm_cmpeq_epi8(b, zero), _mm_cmpeq_epi8(b, ff));
+        __m128i hit = _mm_andnot_si128(skip, _mm_cmpeq_epi8(a, ff));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask) return i + LowestBit(mask);
+    }
+    return FindEntropyScalar(data, size, i);
+}
+
+QP_TARGET_AVX2 size_t FindSoiAvx2(const uint8_t* data, size_t size) {
+    const __m256i ff = _mm256_set1_epi8(static_cast<char>(0xFF));
+    const __m256i d8 = _mm256_set1_epi8(static_cast<char>(0xD8));
+    size_t i = 0;
+    for (; i + 32 + 2 <= size; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 2));
+        __m256i hit = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, ff), _mm256_cmpeq_epi8(b, d8)),
+                                       _mm256_cmpeq_epi8(c, ff));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) return i + LowestBit(mask);
+    }
+    return FindSoiScalar(data, size, i);
+}
+
+QP_TARGET_AVX2 size_t FindEntropyAvx2(const uint8_t* data, size_t size) {
+    const __m256i ff = _mm256_set1_epi8(static_cast<char>(0xFF));
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 + 1 <= size; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        __m256i skip = _mm256_or_si256(_mm256_cmpeq_epi8(b, zero), _mm256_cmpeq_epi8(b, ff));
+        __m256i hit = _mm256_andnot_si256(skip, _mm256_cmpeq_epi8(a, ff));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) return i + LowestBit(mask);
+    }
+    return FindEntropyScalar(data, size, i);
+}
+
+#endif // QP_MARKER_X64
+
+#ifndef QP_MARKER_X64
+size_t FindSoiPortable(const uint8_t* data, size_t size) { return FindSoiScalar(data, size, 0); }
+size_t FindEntropyPortable(const uint8_t* data, size_t size) { return FindEntropyScalar(data, size, 0); }
+#endif
+
+struct MarkerKernels {
+    size_t (*soi)(const uint8_t*, size_t);
+    size_t (*entropy)(const uint8_t*, size_t);
+    const char* name;
+};
+
+const MarkerKernels& Kernels() {
+    static const MarkerKernels kernels = []() -> MarkerKernels {
+#ifdef QP_MARKER_X64
+        if (CpuHasAvx2()) return {FindSoiAvx2, FindEntropyAvx2, "avx2"};
+        return {FindSoiSse2, FindEntropySse2, "sse2"};
+#else
+        return {FindSoiPortable, FindEntropyPortable, "scalar"};
+#endif
+    }();
+    return kernels;
+}
+
+} // namespace
+
+size_t FindSoiCandidate(const uint8_t* data, size_t size) {
+    return Kernels().soi(data, size);
+}
+
+size_t FindEntropyMarker(const uint8_t* data, size_t size) {
+    return Kernels().entropy(data, size);
+}
+
+const char* MarkerScanImplementation() {
+    return Kernels().name;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// JPEG 标记查找：x86 上运行时选择 AVX2（每步 32 字节）或 SSE2（16 字节），其他平台走标量实现。
+// 两个函数都返回匹配处 0xFF 的下标，找不到时返回 size；匹配需要的后续字节必须落在 [0, size) 内。
+
+// SOI 候选：FF D8 FF
+size_t FindSoiCandidate(const uint8_t* data, size_t size);
+
+// 熵编码数据中的标记候选：FF 后跟既非 00（字节填充）也非 FF（填充字节）的字节。
+// RST0-7 同样会被返回，由调用方跳过。
+size_t FindEntropyMarker(const uint8_t* data, size_t size);
+
+// 当前使用的实现："avx2"、"sse2" 或 "scalar"
+const char* MarkerScanImplementation();
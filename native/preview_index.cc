@@ -0,0 +1,236 @@
+#include "preview_index.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+const char kIndexMagic[4] = {'Q', 'P', 'P', 'I'};
+const uint32_t kIndexVersion = 1;
+const uint32_t kMaxPreviewsPerEntry = 64;
+const size_t kCompactSlack = 256;       // 失效记录少于此数时不值得重写
+const size_t kMaxOpenIndexes = 8;       // 进程内同时保持打开的索引数（每个占一个文件句柄与整份条目表）
+
+#ifdef _WIN32
+std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#endif
+
+FILE* OpenFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    return _wfopen(Utf8ToWide(path).c_str(), Utf8ToWide(mode).c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+// 64 位 FNV-1a；键里另有大小与 mtime，冲突时至多多解析一次容器
+uint64_t PathHash(const std::string& path) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : path) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+template <typename T>
+void Put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Take(const std::vector<char>& data, size_t& pos, T& value) {
+    if (data.size() - pos < sizeof(value)) return false;
+    memcpy(&value, data.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+void AppendRecord(std::string& out, uint64_t hash, uint64_t size, double mtime,
+                  const std::vector<EmbeddedPreview>& previews) {
+    Put(out, hash);
+    Put(out, size);
+    Put(out, mtime);
+    Put(out, static_cast<uint32_t>(previews.size()));
+    for (const auto& p : previews) {
+        Put(out, p.offset);
+        Put(out, p.length);
+        Put(out, static_cast<int32_t>(p.width));
+        Put(out, static_cast<int32_t>(p.height));
+        Put(out, static_cast<int32_t>(p.orientation));
+    }
+}
+
+bool SamePreviews(const std::vector<EmbeddedPreview>& a, const std::vector<EmbeddedPreview>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].offset != b[i].offset || a[i].length != b[i].length || a[i].width != b[i].width ||
+            a[i].height != b[i].height || a[i].orientation != b[i].orientation) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<PreviewIndex> PreviewIndex::Open(const std::string& indexPath) {
+    struct Slot {
+        std::shared_ptr<PreviewIndex> index;
+        uint64_t lastUse;
+    };
+    static std::mutex registryMutex;
+    static std::unordered_map<std::string, Slot> registry;
+    static uint64_t clock = 0;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = registry.find(indexPath);
+    if (it != registry.end()) {
+        it->second.lastUse = ++clock;
+        return it->second.index;
+    }
+
+    // 超出上限时关闭最久未用、且没有请求正在使用的索引；正在使用的不逐出，
+    // 免得同一文件在进程内同时有两个实例各自追加
+    if (registry.size() >= kMaxOpenIndexes) {
+        auto victim = registry.end();
+        for (auto slot = registry.begin(); slot != registry.end(); ++slot) {
+            if (slot->second.index.use_count() > 1) continue;
+            if (victim == registry.end() || slot->second.lastUse < victim->second.lastUse) victim = slot;
+        }
+        if (victim != registry.end()) registry.erase(victim);
+    }
+
+    std::shared_ptr<PreviewIndex> index(new PreviewIndex(indexPath));
+    index->Load();
+    registry.emplace(indexPath, Slot{index, ++clock});
+    return index;
+}
+
+PreviewIndex::~PreviewIndex() {
+    if (log_) fclose(log_);
+}
+
+bool PreviewIndex::Lookup(const std::string& path, uint64_t size, double mtime,
+                          std::vector<EmbeddedPreview>& previews) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(PathHash(path));
+    if (it == entries_.end() || it->second.size != size || it->second.mtime != mtime) return false;
+    previews = it->second.previews;
+    return true;
+}
+
+void PreviewIndex::Store(const std::string& path, uint64_t size, double mtime,
+                         const std::vector<EmbeddedPreview>& previews) {
+    uint64_t hash = PathHash(path);
+    std::string record;
+    AppendRecord(record, hash, size, mtime, previews);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(hash);
+    if (it != entries_.end() && it->second.size == size && it->second.mtime == mtime &&
+        SamePreviews(it->second.previews, previews)) {
+        return;
+    }
+    entries_[hash] = {size, mtime, previews};
+
+    // 每条记录单独刷盘，进程中途退出最多丢失最后一条
+    if (log_ && fwrite(record.data(), 1, record.size(), log_) == record.size()) {
+        fflush(log_);
+    }
+}
+
+size_t PreviewIndex::Count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void PreviewIndex::Load() {
+    std::vector<char> data;
+    if (FILE* file = OpenFile(indexPath_, "rb")) {
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        data.resize(fileSize > 0 ? fileSize : 0);
+        if (fread(data.data(), 1, data.size(), file) != data.size()) data.clear();
+        fclose(file);
+    }
+
+    size_t pos = 0;
+    size_t records = 0;
+    size_t validEnd = 0;
+    uint32_t version = 0;
+    bool valid = data.size() >= 8 && memcmp(data.data(), kIndexMagic, 4) == 0;
+    if (valid) {
+        pos = 4;
+        valid = Take(data, pos, version) && version == kIndexVersion;
+        validEnd = pos;
+    }
+
+    while (valid && pos < data.size()) {
+        uint64_t hash, size;
+        double mtime;
+        uint32_t count;
+        if (!Take(data, pos, hash) || !Take(data, pos, size) || !Take(data, pos, mtime) ||
+            !Take(data, pos, count) || count > kMaxPreviewsPerEntry) {
+            break;
+        }
+
+        std::vector<EmbeddedPreview> previews(count);
+        bool complete = true;
+        for (auto& p : previews) {
+            int32_t width, height, orientation;
+            if (!Take(data, pos, p.offset) || !Take(data, pos, p.length) || !Take(data, pos, width) ||
+                !Take(data, pos, height) || !Take(data, pos, orientation)) {
+                complete = false;
+                break;
+            }
+            p.width = width;
+            p.height = height;
+            p.orientation = orientation;
+        }
+        if (!complete) break;
+
+        entries_[hash] = {size, mtime, std::move(previews)};
+        records++;
+        validEnd = pos;
+    }
+
+    // 文件缺失、版本不符、末尾残缺或失效记录过多时整体重写，之后在末尾追加
+    if (!valid || validEnd != data.size() || records > entries_.size() * 2 + kCompactSlack) {
+        if (!Rewrite()) return;
+    }
+    log_ = OpenFile(indexPath_, "ab");
+}
+
+bool PreviewIndex::Rewrite() {
+    std::string buffer(kIndexMagic, 4);
+    Put(buffer, kIndexVersion);
+    for (const auto& entry : entries_) {
+        AppendRecord(buffer, entry.first, entry.second.size, entry.second.mtime, entry.second.previews);
+    }
+
+    // 先写临时文件再替换，避免中途退出留下半个索引
+    std::string tmpPath = indexPath_ + ".tmp";
+    FILE* file = OpenFile(tmpPath, "wb");
+    if (!file) return false;
+    bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) return false;
+
+#ifdef _WIN32
+    return MoveFileExW(Utf8ToWide(tmpPath).c_str(), Utf8ToWide(indexPath_).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmpPath.c_str(), indexPath_.c_str()) == 0;
+#endif
+}
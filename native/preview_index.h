@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "preview_locator.h"
+
+// 预览偏移索引：每个图库根目录一个二进制文件，记录 (路径哈希, 大小, mtime) → 预览阶梯
+// （offset、length、尺寸、方向）。命中后提取预览只剩一次定点读取，不再解析容器结构。
+//
+// 文件是只追加的记录日志：新条目写在末尾，加载时后出现的记录覆盖先前的；
+// 失效记录超过有效条目数时在加载阶段重写压实。末尾写了一半的记录会被忽略。
+class PreviewIndex {
+public:
+    ~PreviewIndex();
+
+    PreviewIndex(const PreviewIndex&) = delete;
+    PreviewIndex& operator=(const PreviewIndex&) = delete;
+
+    // 同一索引文件在进程内共享一个实例，首次打开时加载；最多同时保持 8 个，多出的按最久未用关闭
+    static std::shared_ptr<PreviewIndex> Open(const std::string& indexPath);
+
+    // 大小与 mtime 都与记录一致才算命中
+    bool Lookup(const std::string& path, uint64_t size, double mtime, std::vector<EmbeddedPreview>& previews) const;
+    void Store(const std::string& path, uint64_t size, double mtime, const std::vector<EmbeddedPreview>& previews);
+
+    size_t Count() const;
+
+private:
+    struct Entry {
+        uint64_t size;
+        double mtime;
+        std::vector<EmbeddedPreview> previews;
+    };
+
+    explicit PreviewIndex(const std::string& indexPath) : indexPath_(indexPath) {}
+
+    void Load();
+    bool Rewrite();
+
+    std::string indexPath_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    FILE* log_ = nullptr;
+};
@@ -0,0 +1,666 @@
+#include "preview_locator.h"
+
+#include <algorithm>
+
+#include "marker_scan.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kMaxIfds = 64;             // 防御损坏文件中的环与超长链
+constexpr uint16_t kMaxIfdEntries = 1024;
+constexpr int kMaxJpegMarkers = 64;
+constexpr size_t kScanWindow = 1024 * 1024;
+constexpr size_t kEntropyChunk = 64 * 1024;
+constexpr int kMaxJpegSegments = 4096;
+
+uint16_t Get16(const uint8_t* p, bool little) {
+    return little ? static_cast<uint16_t>(p[0] | (p[1] << 8))
+                  : static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t Get32(const uint8_t* p, bool little) {
+    return little ? (uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24))
+                  : ((uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]));
+}
+
+size_t TiffTypeSize(uint16_t type) {
+    switch (type) {
+        case 1: case 2: case 6: case 7: return 1;
+        case 3: case 8: return 2;
+        case 4: case 9: case 11: case 13: return 4;
+        case 5: case 10: case 12: return 8;
+        default: return 0;
+    }
+}
+
+struct IfdEntry {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    const uint8_t* value;   // 指向项内 4 字节值字段
+};
+
+// 读取 SHORT/LONG/IFD 数组的第 index 个值；总长不超过 4 字节时内联在值字段中
+bool ReadUInt(const ByteSource& source, bool little, const IfdEntry& entry, uint32_t index, uint32_t& value) {
+    size_t size = TiffTypeSize(entry.type);
+    if ((size != 2 && size != 4) || index >= entry.count) return false;
+
+    uint8_t p[4];
+    if (uint64_t(entry.count) * size <= 4) {
+        memcpy(p, entry.value + index * size, size);
+    } else if (!source.Read(uint64_t(Get32(entry.value, little)) + uint64_t(index) * size, p, size)) {
+        return false;
+    }
+    value = size == 2 ? Get16(p, little) : Get32(p, little);
+    return true;
+}
+
+void AddCandidate(const ByteSource& source, uint64_t offset, uint64_t length, std::vector<EmbeddedPreview>& previews) {
+    if (length < 4 || offset > source.Size() || length > source.Size() - offset) return;
+    for (const auto& p : previews) {
+        if (p.offset == offset) return;
+    }
+
+    EmbeddedPreview preview;
+    preview.offset = offset;
+    preview.length = length;
+    if (ReadJpegDimensions(source, offset, length, preview.width, preview.height)) {
+        previews.push_back(preview);
+    }
+}
+
+// 文件中一段区域的视图，用于解析嵌在 JPEG APP1、CR3 CMT1 中的 TIFF 结构
+class SubSource : public ByteSource {
+public:
+    SubSource(const ByteSource& source, uint64_t base, uint64_t size)
+        : source_(source), base_(base), size_(size) {}
+
+    uint64_t Size() const override { return size_; }
+    bool Read(uint64_t offset, uint8_t* dst, size_t length) const override {
+        if (offset > size_ || length > size_ - offset) return false;
+        return source_.Read(base_ + offset, dst, length);
+    }
+
+private:
+    const ByteSource& source_;
+    uint64_t base_;
+    uint64_t size_;
+};
+
+// TIFF 结构 IFD0 中的 Orientation（0x0112），没有或越界时返回 0
+int ReadTiffOrientation(const ByteSource& source) {
+    uint8_t header[8];
+    if (!source.Read(0, header, sizeof(header))) return 0;
+
+    bool little;
+    if (header[0] == 'I' && header[1] == 'I') little = true;
+    else if (header[0] == 'M' && header[1] == 'M') little = false;
+    else return 0;
+
+    uint32_t ifd0 = Get32(header + 4, little);
+    uint8_t countBytes[2];
+    if (!source.Read(ifd0, countBytes, 2)) return 0;
+    uint16_t count = Get16(countBytes, little);
+
+    uint8_t e[12];
+    for (uint16_t i = 0; i < count && i < kMaxIfdEntries; i++) {
+        if (!source.Read(uint64_t(ifd0) + 2 + uint64_t(i) * 12, e, 12)) return 0;
+        if (Get16(e, little) != 0x0112) continue;
+
+        IfdEntry entry{0x0112, Get16(e + 2, little), Get32(e + 4, little), e + 8};
+        uint32_t value;
+        if (!ReadUInt(source, little, entry, 0, value) || value < 1 || value > 8) return 0;
+        return static_cast<int>(value);
+    }
+    return 0;
+}
+
+// 预览自身 EXIF 中的方向优先，读不到时用容器级方向，仍然没有则为 1
+void ApplyOrientation(const ByteSource& source, std::vector<EmbeddedPreview>& previews, int containerOrientation) {
+    for (auto& p : previews) {
+        int own = ReadJpegOrientation(source, p.offset, p.length);
+        p.orientation = own ? own : (containerOrientation ? containerOrientation : 1);
+    }
+}
+
+void SortPreviews(std::vector<EmbeddedPreview>& previews) {
+    std::sort(previews.begin(), previews.end(), [](const EmbeddedPreview& a, const EmbeddedPreview& b) {
+        uint64_t areaA = uint64_t(a.width) * a.height, areaB = uint64_t(b.width) * b.height;
+        return areaA != areaB ? areaA < areaB : a.length < b.length;
+    });
+}
+
+// ---- ISO-BMFF (CR3) ----
+
+constexpr int kMaxBoxDepth = 8;
+constexpr int kMaxBoxes = 4096;
+
+constexpr uint32_t FourCC(const char (&s)[5]) {
+    return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) |
+           (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+}
+
+// moov 内的 Canon 元数据盒（CMT1-4、THMB），以及顶层承载 PRVW 的盒
+constexpr uint8_t kCanonUuid[16] = {0x85, 0xc0, 0xb6, 0x87, 0x82, 0x0f, 0x11, 0xe0,
+                                    0x81, 0x11, 0xf4, 0xce, 0x46, 0x2b, 0x6a, 0x48};
+constexpr uint8_t kPreviewUuid[16] = {0xea, 0xf4, 0x2b, 0x5e, 0x1c, 0x98, 0x4b, 0x88,
+                                      0xb9, 0xfb, 0xb7, 0xdc, 0x40, 0x6e, 0x4d, 0x16};
+
+struct Box {
+    uint32_t type;
+    uint64_t payload;       // 头部（含 uuid 用户类型）之后的位置
+    uint64_t end;
+    uint8_t uuid[16];
+};
+
+bool ReadBox(const ByteSource& source, uint64_t offset, uint64_t limit, Box& box) {
+    uint8_t h[16];
+    if (offset + 8 > limit || !source.Read(offset, h, 8)) return false;
+
+    uint64_t size = Get32(h, false);
+    uint64_t header = 8;
+    box.type = Get32(h + 4, false);
+    if (size == 1) {
+        if (offset + 16 > limit || !source.Read(offset + 8, h + 8, 8)) return false;
+        size = (uint64_t(Get32(h + 8, false)) << 32) | Get32(h + 12, false);
+        header = 16;
+    } else if (size == 0) {
+        size = limit - offset;
+    }
+    if (size < header || size > limit - offset) return false;
+
+    box.end = offset + size;
+    box.payload = offset + header;
+    if (box.type == FourCC("uuid")) {
+        if (box.payload + 16 > box.end || !source.Read(box.payload, box.uuid, 16)) return false;
+        box.payload += 16;
+    }
+    return true;
+}
+
+struct BmffContext {
+    const ByteSource& source;
+    std::vector<EmbeddedPreview>& previews;
+    int boxes;
+    int orientation;        // CMT1（IFD0）中的方向
+};
+
+// THMB 与 PRVW 的 JPEG 都从载荷第 16 字节开始，长度字段分别位于载荷第 8、12 字节
+void AddCanonPreviewBox(BmffContext& ctx, const Box& box, uint64_t sizeField) {
+    uint8_t p[4];
+    uint64_t data = box.payload + 16;
+    if (data > box.end || !ctx.source.Read(box.payload + sizeField, p, 4)) return;
+    uint64_t length = std::min<uint64_t>(Get32(p, false), box.end - data);
+    AddCandidate(ctx.source, data, length, ctx.previews);
+}
+
+// stbl 中第一个样本的偏移（stco/co64）与大小（stsz）；CR3 的 JPEG 轨道只有一个样本
+void AddFirstSample(BmffContext& ctx, const Box& stbl) {
+    uint64_t offset = 0, length = 0;
+    uint8_t p[12];
+    for (uint64_t pos = stbl.payload; pos < stbl.end && ctx.boxes++ < kMaxBoxes;) {
+        Box box;
+        if (!ReadBox(ctx.source, pos, stbl.end, box)) return;
+
+        if (box.type == FourCC("stsz") && ctx.source.Read(box.payload, p, 12)) {
+            length = Get32(p + 4, false);
+            if (length == 0 && Get32(p + 8, false) > 0 && ctx.source.Read(box.payload + 12, p, 4)) {
+                length = Get32(p, false);
+            }
+        } else if (box.type == FourCC("co64") && ctx.source.Read(box.payload + 4, p, 12) && Get32(p, false) > 0) {
+            offset = (uint64_t(Get32(p + 4, false)) << 32) | Get32(p + 8, false);
+        } else if (box.type == FourCC("stco") && ctx.source.Read(box.payload + 4, p, 8) && Get32(p, false) > 0) {
+            offset = Get32(p + 4, false);
+        }
+        pos = box.end;
+    }
+    if (offset != 0 && length != 0) AddCandidate(ctx.source, offset, length, ctx.previews);
+}
+
+void WalkBoxes(BmffContext& ctx, uint64_t begin, uint64_t end, int depth) {
+    if (depth > kMaxBoxDepth) return;
+
+    for (uint64_t pos = begin; pos < end && ctx.boxes++ < kMaxBoxes;) {
+        Box box;
+        if (!ReadBox(ctx.source, pos, end, box)) return;
+
+        switch (box.type) {
+            case FourCC("moov"):
+            case FourCC("trak"):
+            case FourCC("mdia"):
+            case FourCC("minf"):
+                WalkBoxes(ctx, box.payload, box.end, depth + 1);
+                break;
+            case FourCC("stbl"):
+                // 非 JPEG 轨道（CRX 原始数据）会在 SOF 校验中被排除
+                AddFirstSample(ctx, box);
+                break;
+            case FourCC("uuid"):
+                if (memcmp(box.uuid, kCanonUuid, 16) == 0) {
+                    WalkBoxes(ctx, box.payload, box.end, depth + 1);
+                } else if (memcmp(box.uuid, kPreviewUuid, 16) == 0) {
+                    WalkBoxes(ctx, box.payload + 8, box.end, depth + 1);
+                }
+                break;
+            case FourCC("CMT1"):
+                ctx.orientation = ReadTiffOrientation(SubSource(ctx.source, box.payload, box.end - box.payload));
+                break;
+            case FourCC("THMB"):
+                AddCanonPreviewBox(ctx, box, 8);
+                break;
+            case FourCC("PRVW"):
+                AddCanonPreviewBox(ctx, box, 12);
+                break;
+            default:
+                break;
+        }
+        pos = box.end;
+    }
+}
+
+// ---- 兜底扫描 ----
+
+// 从 pos 起扫描熵编码数据，返回下一个非 RST 标记的位置
+bool SkipEntropyData(const ByteSource& source, uint64_t pos, uint64_t limit,
+                     std::vector<uint8_t>& buffer, uint64_t& marker) {
+    buffer.resize(kEntropyChunk);
+    while (pos + 1 < limit) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(buffer.size(), limit - pos));
+        if (!source.Read(pos, buffer.data(), count)) return false;
+
+        for (size_t from = 0;;) {
+            size_t hit = FindEntropyMarker(buffer.data() + from, count - from);
+            if (hit == count - from) break;
+            size_t at = from + hit;
+            uint8_t code = buffer[at + 1];
+            if (code < 0xD0 || code > 0xD7) {
+                marker = pos + at;
+                return true;
+            }
+            from = at + 2;
+        }
+        // 末字节可能是跨块标记的 0xFF，下一块从它开始
+        pos += count - 1;
+    }
+    return false;
+}
+
+// 按段长度走完一个 JPEG：SOI 后逐段跳过，SOS 后扫描熵编码数据，直到 EOI。
+// 只有结构完整的 JPEG 才算数，不再把某个 SOI 与其后任意一个 EOI 配对。
+bool WalkJpeg(const ByteSource& source, uint64_t start, uint64_t limit,
+              std::vector<uint8_t>& buffer, EmbeddedPreview& jpeg) {
+    jpeg = EmbeddedPreview();
+    jpeg.offset = start;
+
+    uint8_t p[9];
+    uint64_t pos = start + 2;
+    bool scanned = false;
+    for (int i = 0; i < kMaxJpegSegments; i++) {
+        if (pos + 2 > limit || !source.Read(pos, p, 2) || p[0] != 0xFF) return false;
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0xD9) {
+            if (!scanned) return false;
+            jpeg.length = pos + 2 - start;
+            return true;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0x00 || marker == 0xD8) return false;
+
+        if (pos + 4 > limit || !source.Read(pos, p, 4)) return false;
+        uint32_t length = (uint32_t(p[2]) << 8) | p[3];
+        uint64_t next = pos + 2 + length;
+        if (length < 2 || next > limit) return false;
+
+        if (marker >= 0xC0 && marker <= 0xC2 && jpeg.width == 0 && length >= 7 && source.Read(pos, p, 9)) {
+            jpeg.height = (p[5] << 8) | p[6];
+            jpeg.width = (p[7] << 8) | p[8];
+        }
+        if (marker == 0xDA) {
+            if (!SkipEntropyData(source, next, limit, buffer, pos)) return false;
+            scanned = true;
+            continue;
+        }
+        pos = next;
+    }
+    return false;
+}
+
+// 有损 JPEG（带尺寸）优先按像素面积比较，其次比较字节长度
+bool IsLarger(const EmbeddedPreview& a, const EmbeddedPreview& b) {
+    uint64_t areaA = uint64_t(a.width) * a.height, areaB = uint64_t(b.width) * b.height;
+    return areaA != areaB ? areaA > areaB : a.length > b.length;
+}
+
+#ifdef _WIN32
+std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#endif
+
+} // namespace
+
+FileSource::~FileSource() {
+#ifdef _WIN32
+    if (handle_) CloseHandle(static_cast<HANDLE>(handle_));
+#else
+    if (fd_ >= 0) close(fd_);
+#endif
+}
+
+bool FileSource::Open(const std::string& path, bool readHead) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(Utf8ToWide(path).c_str(), GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    handle_ = handle;
+
+    BY_HANDLE_FILE_INFORMATION fileInfo;
+    if (!GetFileInformationByHandle(handle, &fileInfo)) return false;
+    size_ = (static_cast<uint64_t>(fileInfo.nFileSizeHigh) << 32) | fileInfo.nFileSizeLow;
+    uint64_t ticks = (static_cast<uint64_t>(fileInfo.ftLastWriteTime.dwHighDateTime) << 32) |
+                     fileInfo.ftLastWriteTime.dwLowDateTime;
+    mtime_ = ticks / 10000.0 - 11644473600000.0;
+#else
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) return false;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    size_ = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    mtime_ = static_cast<double>(st.st_mtimespec.tv_sec) * 1000.0 + st.st_mtimespec.tv_nsec / 1e6;
+#else
+    mtime_ = static_cast<double>(st.st_mtim.tv_sec) * 1000.0 + st.st_mtim.tv_nsec / 1e6;
+#endif
+#endif
+
+    return readHead ? ReadHead() : true;
+}
+
+bool FileSource::ReadHead() {
+    if (!head_.empty()) return true;
+    std::vector<uint8_t> head(static_cast<size_t>(std::min<uint64_t>(size_, kHeadBytes)));
+    if (!ReadFromFile(0, head.data(), head.size())) return false;
+    head_ = std::move(head);
+    return true;
+}
+
+bool FileSource::Read(uint64_t offset, uint8_t* dst, size_t length) const {
+    if (offset > size_ || length > size_ - offset) return false;
+    if (offset + length <= head_.size()) {
+        memcpy(dst, head_.data() + offset, length);
+        return true;
+    }
+    return ReadFromFile(offset, dst, length);
+}
+
+bool FileSource::ReadFromFile(uint64_t offset, uint8_t* dst, size_t length) const {
+    while (length > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 1u << 30));
+        DWORD bytesRead = 0;
+        if (!ReadFile(static_cast<HANDLE>(handle_), dst, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+            return false;
+        }
+#else
+        ssize_t bytesRead = pread(fd_, dst, length, static_cast<off_t>(offset));
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead <= 0) return false;
+#endif
+        dst += bytesRead;
+        offset += bytesRead;
+        length -= static_cast<size_t>(bytesRead);
+    }
+    return true;
+}
+
+bool ReadJpegDimensions(const ByteSource& source, uint64_t offset, uint64_t length, int& width, int& height) {
+    uint8_t p[9];
+    if (length < 4 || !source.Read(offset, p, 2) || p[0] != 0xFF || p[1] != 0xD8) return false;
+
+    uint64_t end = offset + length;
+    uint64_t pos = offset + 2;
+    for (int i = 0; i < kMaxJpegMarkers && pos + 4 <= end; i++) {
+        if (!source.Read(pos, p, 4) || p[0] != 0xFF) return false;
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) return false;
+
+        bool isSof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isSof) {
+            if (marker > 0xC2 || pos + 9 > end || !source.Read(pos, p, 9)) return false;
+            height = (p[5] << 8) | p[6];
+            width = (p[7] << 8) | p[8];
+            return width > 0 && height > 0;
+        }
+        pos += 2 + ((uint32_t(p[2]) << 8) | p[3]);
+    }
+    return false;
+}
+
+int ReadJpegOrientation(const ByteSource& source, uint64_t offset, uint64_t length) {
+    uint8_t p[10];
+    if (length < 4 || !source.Read(offset, p, 2) || p[0] != 0xFF || p[1] != 0xD8) return 0;
+
+    uint64_t end = offset + length;
+    uint64_t pos = offset + 2;
+    for (int i = 0; i < kMaxJpegMarkers && pos + 4 <= end; i++) {
+        if (!source.Read(pos, p, 4) || p[0] != 0xFF) return 0;
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        // EXIF 只会出现在帧头之前
+        if (marker == 0xDA || marker == 0xD9 || (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xCC)) {
+            return 0;
+        }
+
+        uint32_t segment = (uint32_t(p[2]) << 8) | p[3];
+        if (marker == 0xE1 && segment >= 16 && pos + 2 + segment <= end &&
+            source.Read(pos + 4, p, 6) && memcmp(p, "Exif\0\0", 6) == 0) {
+            return ReadTiffOrientation(SubSource(source, pos + 10, segment - 8));
+        }
+        pos += 2 + segment;
+    }
+    return 0;
+}
+
+bool LocateTiffPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews) {
+    uint8_t header[8];
+    if (!source.Read(0, header, sizeof(header))) return false;
+
+    bool little;
+    if (header[0] == 'I' && header[1] == 'I') little = true;
+    else if (header[0] == 'M' && header[1] == 'M') little = false;
+    else return false;
+
+    // 42 为标准 TIFF；ORF 用 "RO"/"RS"，RW2 用 0x55
+    uint16_t magic = Get16(header + 2, little);
+    if (magic != 42 && magic != 0x4F52 && magic != 0x5352 && magic != 0x55) return false;
+
+    std::vector<uint32_t> pending = {Get32(header + 4, little)};
+    std::vector<uint32_t> visited;
+    std::vector<uint8_t> entries;
+
+    while (!pending.empty() && visited.size() < kMaxIfds) {
+        uint32_t ifd = pending.back();
+        pending.pop_back();
+        if (ifd == 0 || std::find(visited.begin(), visited.end(), ifd) != visited.end()) continue;
+        visited.push_back(ifd);
+
+        uint8_t countBytes[2];
+        if (!source.Read(ifd, countBytes, 2)) continue;
+        uint16_t count = Get16(countBytes, little);
+        if (count == 0 || count > kMaxIfdEntries) continue;
+
+        // 一次读入全部目录项和下一个 IFD 的偏移
+        size_t tableSize = size_t(count) * 12;
+        entries.resize(tableSize + 4);
+        bool hasNext = source.Read(uint64_t(ifd) + 2, entries.data(), tableSize + 4);
+        if (!hasNext && !source.Read(uint64_t(ifd) + 2, entries.data(), tableSize)) continue;
+
+        uint32_t compression = 0, jpegOffset = 0, jpegLength = 0;
+        IfdEntry strips{}, stripCounts{};
+
+        for (uint16_t i = 0; i < count; i++) {
+            const uint8_t* e = entries.data() + size_t(i) * 12;
+            IfdEntry entry{Get16(e, little), Get16(e + 2, little), Get32(e + 4, little), e + 8};
+
+            switch (entry.tag) {
+                case 0x0103: ReadUInt(source, little, entry, 0, compression); break;
+                case 0x0111: strips = entry; break;
+                case 0x0117: stripCounts = entry; break;
+                case 0x0201: ReadUInt(source, little, entry, 0, jpegOffset); break;
+                case 0x0202: ReadUInt(source, little, entry, 0, jpegLength); break;
+                case 0x002E:
+                    // RW2 的 JpgFromRaw：UNDEFINED 类型，count 即 JPEG 长度，值字段为偏移
+                    if (magic == 0x55 && entry.type == 7 && entry.count > 4) {
+                        AddCandidate(source, Get32(entry.value, little), entry.count, previews);
+                    }
+                    break;
+                case 0x014A:
+                    for (uint32_t k = 0; k < entry.count && k < kMaxIfds; k++) {
+                        uint32_t sub;
+                        if (ReadUInt(source, little, entry, k, sub)) pending.push_back(sub);
+                    }
+                    break;
+                default: break;
+            }
+        }
+
+        if (jpegOffset != 0 && jpegLength != 0) {
+            AddCandidate(source, jpegOffset, jpegLength, previews);
+        }
+        // 单条带的 JPEG 压缩图像（CR2 IFD0 的大预览、DNG/NEF 的预览 SubIFD）
+        if ((compression == 6 || compression == 7) && strips.count == 1 && stripCounts.count == 1) {
+            uint32_t offset, length;
+            if (ReadUInt(source, little, strips, 0, offset) && ReadUInt(source, little, stripCounts, 0, length)) {
+                AddCandidate(source, offset, length, previews);
+            }
+        }
+
+        if (hasNext) pending.push_back(Get32(entries.data() + tableSize, little));
+    }
+
+    ApplyOrientation(source, previews, ReadTiffOrientation(source));
+    SortPreviews(previews);
+    return true;
+}
+
+bool LocateBmffPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews) {
+    uint8_t header[8];
+    if (!source.Read(0, header, sizeof(header)) || Get32(header + 4, false) != FourCC("ftyp")) return false;
+
+    BmffContext ctx{source, previews, 0, 0};
+    WalkBoxes(ctx, 0, source.Size(), 0);
+    ApplyOrientation(source, previews, ctx.orientation);
+    SortPreviews(previews);
+    return true;
+}
+
+bool LocateRafPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews) {
+    // 固定头：16 字节魔数，偏移 84/88 处为大端的 JPEG 偏移与长度
+    uint8_t header[92];
+    if (!source.Read(0, header, sizeof(header)) || memcmp(header, "FUJIFILMCCD-RAW ", 16) != 0) return false;
+
+    AddCandidate(source, Get32(header + 84, false), Get32(header + 88, false), previews);
+    ApplyOrientation(source, previews, 0);
+    return true;
+}
+
+bool LocateEmbeddedPreviews(const ByteSource& source, ImageFormat format, std::vector<EmbeddedPreview>& previews) {
+    if (format == ImageFormat::Cr3) return LocateBmffPreviews(source, previews);
+    if (format == ImageFormat::Raf) return LocateRafPreviews(source, previews);
+    if (IsTiffBasedFormat(format)) return LocateTiffPreviews(source, previews);
+    return false;
+}
+
+const EmbeddedPreview& SelectPreview(const std::vector<EmbeddedPreview>& previews, int minEdge) {
+    if (minEdge > 0) {
+        for (const auto& p : previews) {
+            if (std::min(p.width, p.height) >= minEdge) return p;
+        }
+    }
+    return previews.back();
+}
+
+bool ScanForLargestJpeg(const ByteSource& source, EmbeddedPreview& preview) {
+    std::vector<uint8_t> window(kScanWindow), entropy;
+    uint64_t size = source.Size();
+    bool found = false;
+
+    for (uint64_t base = 0; base + 3 <= size;) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(window.size(), size - base));
+        if (!source.Read(base, window.data(), count)) return false;
+
+        // 末两字节留给下一窗口，跨窗口的 FF D8 FF 不会漏掉
+        uint64_t next = base + count - 2;
+        size_t from = 0;
+        while (from < count) {
+            size_t hit = FindSoiCandidate(window.data() + from, count - from);
+            if (hit == count - from) break;
+
+            uint64_t start = base + from + hit;
+            EmbeddedPreview jpeg;
+            if (!WalkJpeg(source, start, size, entropy, jpeg)) {
+                from += hit + 1;
+                continue;
+            }
+            if (!found || IsLarger(jpeg, preview)) {
+                preview = jpeg;
+                found = true;
+            }
+            // 整段跳过，APP1 内的 EXIF 缩略图已被段遍历越过
+            uint64_t end = start + jpeg.length;
+            if (end >= base + count) {
+                next = end;
+                break;
+            }
+            from = static_cast<size_t>(end - base);
+            next = std::max(next, end);
+        }
+        base = next;
+    }
+    if (found) {
+        int orientation = ReadJpegOrientation(source, preview.offset, preview.length);
+        preview.orientation = orientation ? orientation : 1;
+    }
+    return found;
+}
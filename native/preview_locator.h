@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "image_formats.h"
+
+// 随机读取接口：解析器只按需读取目录结构和预览头部，不必持有整个文件
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+    virtual uint64_t Size() const = 0;
+    virtual bool Read(uint64_t offset, uint8_t* dst, size_t length) const = 0;
+};
+
+class MemorySource : public ByteSource {
+public:
+    MemorySource(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint64_t Size() const override { return size_; }
+    bool Read(uint64_t offset, uint8_t* dst, size_t length) const override {
+        if (offset > size_ || length > size_ - offset) return false;
+        memcpy(dst, data_ + offset, length);
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+};
+
+// 文件随机读取：文件头一次读入缓存，其余范围用 pread（Windows 为带偏移的 ReadFile）按需读取，
+// 提取预览时的 I/O 量为“文件头 + 预览本身”，与 RAW 文件大小无关。
+// 已知预览位置时可以 Open(path, false) 跳过文件头，只做一次定点读取
+class FileSource : public ByteSource {
+public:
+    static constexpr size_t kHeadBytes = 64 * 1024;
+
+    FileSource() = default;
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    bool Open(const std::string& path, bool readHead = true);
+    bool ReadHead();
+
+    uint64_t Size() const override { return size_; }
+    double Mtime() const { return mtime_; }     // 毫秒，与扫描结果的 mtime 一致
+    bool Read(uint64_t offset, uint8_t* dst, size_t length) const override;
+
+    const uint8_t* Head() const { return head_.data(); }
+    size_t HeadSize() const { return head_.size(); }
+
+private:
+    bool ReadFromFile(uint64_t offset, uint8_t* dst, size_t length) const;
+
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    uint64_t size_ = 0;
+    double mtime_ = 0;
+    std::vector<uint8_t> head_;
+};
+
+// 内嵌 JPEG 在文件中的位置与尺寸
+struct EmbeddedPreview {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    int width = 0;
+    int height = 0;
+    int orientation = 1;    // EXIF Orientation（1-8）：预览自身的 EXIF 优先，其次取容器 IFD0 / CR3 CMT1
+};
+
+// 从 offset 处的 JPEG 头读取 SOF 尺寸；只接受 SOF0-2（有损），
+// 用于排除 CR2/DNG 中以无损 JPEG 编码的原始数据
+bool ReadJpegDimensions(const ByteSource& source, uint64_t offset, uint64_t length, int& width, int& height);
+
+// 读取 JPEG APP1 EXIF 中的 Orientation，没有时返回 0
+int ReadJpegOrientation(const ByteSource& source, uint64_t offset, uint64_t length);
+
+// 沿 TIFF 目录结构定位内嵌 JPEG：IFD 链、SubIFDs、JPEGInterchangeFormat/Length、
+// 单条带 JPEG 压缩图像，以及 RW2 IFD0 的 JpgFromRaw（0x002E）。读取量与 IFD 项数成正比，与文件大小无关；结果按像素面积从小到大排列。
+bool LocateTiffPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews);
+
+// Canon CR3（ISO-BMFF）：moov 内 Canon uuid 盒中的 THMB（160px）、顶层 uuid 盒中的 PRVW（1620px），
+// 以及各 trak 样本表指向 mdat 的全尺寸 JPEG。只读盒头部与样本表，结果按像素面积从小到大排列。
+bool LocateBmffPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews);
+
+// Fujifilm RAF：文件头直接给出内嵌 JPEG 的偏移与长度
+bool LocateRafPreviews(const ByteSource& source, std::vector<EmbeddedPreview>& previews);
+
+// 按格式分派到对应容器解析器；不支持的格式返回 false，由调用方退回字节扫描
+bool LocateEmbeddedPreviews(const ByteSource& source, ImageFormat format, std::vector<EmbeddedPreview>& previews);
+
+// 从按面积升序的预览阶梯中挑选短边不小于 minEdge 的最小一张；都不够大或 minEdge <= 0 时取最大的。
+// previews 不能为空
+const EmbeddedPreview& SelectPreview(const std::vector<EmbeddedPreview>& previews, int minEdge);
+
+// 结构解析失败时的兜底：分块用 SIMD 查找 FF D8 FF 候选，再按段长度走完整个 JPEG 加以验证，
+// 返回最大的一张（有损 JPEG 按像素面积，其次按字节长度）。内存占用为一个窗口。
+bool ScanForLargestJpeg(const ByteSource& source, EmbeddedPreview& preview);
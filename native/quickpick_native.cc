@@ -3,6 +3,7 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -12,6 +13,16 @@
 #include <dirent.h>
 #endif
 
+#include "dir_walker.h"
+#include "scan_columns.h"
+#include "file_sort.h"
+#include "work_pool.h"
+#include "image_formats.h"
+#include "jpeg_codec.h"
+#include "jpeg_thumbnail.h"
+#include "preview_locator.h"
+#include "thumbnail_cache.h"
+
 // ==================== Thumbnail Generator ====================
 
 struct ThumbnailResult {
@@ -20,6 +31,7 @@ struct ThumbnailResult {
     int width;
     int height;
     bool success;
+    bool cached;
     std::string error;
 };
 
@@ -29,40 +41,47 @@ public:
                        const std::vector<std::string>& paths,
                        int maxWidth,
                        int maxHeight,
-                       int quality)
+                       int quality,
+                       PixelLayout layout,
+                       bool parallel,
+                       const std::string& cacheDir,
+                       uint64_t cacheBytes)
         : Napi::AsyncWorker(env),
           paths_(paths),
           maxWidth_(maxWidth),
           maxHeight_(maxHeight),
           quality_(quality),
+          layout_(layout),
+          parallel_(parallel),
+          cacheDir_(cacheDir),
+          cacheBytes_(cacheBytes),
           deferred_(Napi::Promise::Deferred::New(env)) {}
     
     Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 protected:
     void Execute() {
-        results_.reserve(paths_.size());
+        // 首次打开要读索引，放在工作线程；同一目录进程内只加载一次
+        if (!cacheDir_.empty()) {
+            cache_ = ThumbnailCache::Open(cacheDir_, cacheBytes_);
+        }
+        results_.resize(paths_.size());
         
-        for (size_t i = 0; i < paths_.size(); i++) {
-            ThumbnailResult result;
-            result.path = paths_[i];
-            result.success = false;
-            
-            std::string ext = GetExtension(paths_[i]);
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            
-            if (ext == ".jpg" || ext == ".jpeg") {
-                result = GenerateJpegThumbnail(paths_[i]);
-            } else if (ext == ".png") {
-                result = GeneratePngThumbnail(paths_[i]);
-            } else if (IsRawFile(ext)) {
-                result.error = "RAW format requires libraw library";
-            } else {
-                result.error = "Unsupported format";
+        // 每张图写入自己的下标，结果顺序与请求一致；单张时不值得分发
+        if (!parallel_ || paths_.size() < 2) {
+            for (size_t i = 0; i < paths_.size(); i++) {
+                results_[i] = GenerateThumbnail(paths_[i]);
             }
-            
-            results_.push_back(result);
+            return;
+        }
+        
+        TaskGroup group(WorkStealingPool::Shared());
+        for (size_t i = 0; i < paths_.size(); i++) {
+            group.Run([this, i]() {
+                results_[i] = GenerateThumbnail(paths_[i]);
+            });
         }
+        group.Wait();
     }
     
     void OnOK() {
@@ -75,11 +94,15 @@ protected:
             obj.Set("width", Napi::Number::New(env, results_[i].width));
             obj.Set("height", Napi::Number::New(env, results_[i].height));
             obj.Set("success", Napi::Boolean::New(env, results_[i].success));
+            obj.Set("cached", Napi::Boolean::New(env, results_[i].cached));
             
             if (results_[i].success && !results_[i].data.empty()) {
-                Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                    env, results_[i].data.data(), results_[i].data.size());
-                obj.Set("data", buffer);
+                if (layout_ == PixelLayout::Rgb) {
+                    obj.Set("data", ExternalBuffer(env, std::move(results_[i].data)));
+                } else {
+                    obj.Set("data", ExternalClampedArray(env, std::move(results_[i].data)));
+                }
+                obj.Set("format", Napi::String::New(env, FormatName(layout_)));
             }
             
             if (!results_[i].error.empty()) {
@@ -101,54 +124,146 @@ private:
     int maxWidth_;
     int maxHeight_;
     int quality_;
+    PixelLayout layout_;        // Rgb 表示输出 JPEG，Rgba/Bgra 输出转正后的像素
+    bool parallel_;
+    std::string cacheDir_;
+    uint64_t cacheBytes_;
+    std::shared_ptr<ThumbnailCache> cache_;     // 未指定 cacheDir 时为空
     Napi::Promise::Deferred deferred_;
     std::vector<ThumbnailResult> results_;
     
-    std::string GetExtension(const std::string& path) {
-        size_t pos = path.find_last_of('.');
-        if (pos != std::string::npos) {
-            return path.substr(pos);
+    ThumbnailResult GenerateThumbnail(const std::string& path) {
+        ImageFormat format = DetectImageFormat(path);
+        if (format == ImageFormat::Jpeg) {
+            return GenerateJpegThumbnail(path);
         }
-        return "";
-    }
-    
-    bool IsRawFile(const std::string& ext) {
-        static const std::vector<std::string> rawExts = {
-            ".cr2", ".cr3", ".nef", ".arw", ".dng", ".raf", 
-            ".orf", ".rw2", ".pef", ".srw", ".x3f", ".raw"
-        };
-        return std::find(rawExts.begin(), rawExts.end(), ext) != rawExts.end();
+        if (format == ImageFormat::Png) {
+            return GeneratePngThumbnail(path);
+        }
+        
+        ThumbnailResult result;
+        result.path = path;
+        result.success = false;
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
+        result.error = IsRawFormat(format) ? "RAW format requires libraw library" : "Unsupported format";
+        return result;
     }
     
     ThumbnailResult GenerateJpegThumbnail(const std::string& path) {
         ThumbnailResult result;
         result.path = path;
         result.success = false;
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
         
-        FILE* file = fopen(path.c_str(), "rb");
-        if (!file) {
-            result.error = "Cannot open file";
+        // 未启用 libjpeg 时原样返回，由渲染端解码；像素输出无从谈起
+        if (!JpegCodecAvailable() && layout_ != PixelLayout::Rgb) {
+            result.error = "Pixel output requires libjpeg";
+            return result;
+        }
+        if (!JpegCodecAvailable()) {
+            // 宽高取文件头里的实际尺寸，读不到时为 0，不能冒充请求的框
+            result.success = ReadWholeFile(path, result.data, result.error);
+            MemorySource memory(result.data.data(), result.data.size());
+            if (result.success && !ReadJpegDimensions(memory, 0, result.data.size(), result.width, result.height)) {
+                result.width = 0;
+                result.height = 0;
+            }
             return result;
         }
         
-        fseek(file, 0, SEEK_END);
-        long fileSize = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        std::vector<uint8_t> fileData(fileSize);
-        fread(fileData.data(), 1, fileSize, file);
-        fclose(file);
+        FileSource source;
+        if (!source.Open(path, false)) {
+            result.error = "Cannot open file";
+            return result;
+        }
         
-        result.data = std::move(fileData);
-        result.success = true;
-        result.width = maxWidth_;
-        result.height = maxHeight_;
+        // 磁盘缓存按 (路径, 大小, mtime, 目标尺寸, 质量) 命中，直接返回上次的编码结果
+        ThumbnailCacheKey key;
+        if (cache_) {
+            key = {path, source.Size(), source.Mtime(), maxWidth_, maxHeight_, quality_, static_cast<int>(layout_)};
+            if (cache_->Lookup(key, result.data, result.width, result.height)) {
+                result.success = true;
+                result.cached = true;
+                return result;
+            }
+        }
         
+        // 解码器、编码器与读文件缓冲都取当前线程的上下文，跨图片复用
+        ThumbnailContext& context = ThumbnailContext::ForThread();
+        std::vector<uint8_t>& fileData = context.FileBuffer();
+        int width, height;
+        bool ok = ReadWholeFile(source, fileData, result.error);
+        if (ok && layout_ == PixelLayout::Rgb) {
+            ok = context.Make(fileData.data(), fileData.size(), maxWidth_, maxHeight_, quality_,
+                              result.data, width, height, result.error);
+        } else if (ok) {
+            ok = context.MakePixels(fileData.data(), fileData.size(), maxWidth_, maxHeight_, layout_,
+                                    result.data, width, height, result.error);
+        }
+        if (ok) {
+            result.width = width;
+            result.height = height;
+            result.success = true;
+            if (cache_) cache_->Store(key, result.data, width, height);
+        }
+        context.Trim();
         return result;
     }
     
+    // PNG 尚无解码器，原样返回
     ThumbnailResult GeneratePngThumbnail(const std::string& path) {
-        return GenerateJpegThumbnail(path);
+        ThumbnailResult result;
+        result.path = path;
+        if (layout_ != PixelLayout::Rgb) {
+            result.success = false;
+            result.cached = false;
+            result.width = 0;
+            result.height = 0;
+            result.error = "Pixel output supports JPEG only";
+            return result;
+        }
+        result.success = ReadWholeFile(path, result.data, result.error);
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
+        // 实际尺寸取 IHDR：签名 8 字节后紧跟长度与 "IHDR"，再是大端宽高
+        const std::vector<uint8_t>& d = result.data;
+        if (result.success && d.size() >= 24 && memcmp(d.data() + 12, "IHDR", 4) == 0) {
+            result.width = int(uint32_t(d[16]) << 24 | uint32_t(d[17]) << 16 | uint32_t(d[18]) << 8 | d[19]);
+            result.height = int(uint32_t(d[20]) << 24 | uint32_t(d[21]) << 16 | uint32_t(d[22]) << 8 | d[23]);
+        }
+        return result;
+    }
+    
+    static const char* FormatName(PixelLayout layout) {
+        switch (layout) {
+            case PixelLayout::Rgba: return "rgba";
+            case PixelLayout::Bgra: return "bgra";
+            default: return "jpeg";
+        }
+    }
+    
+    static bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& data, std::string& error) {
+        FileSource source;
+        if (!source.Open(path, false)) {
+            error = "Cannot open file";
+            return false;
+        }
+        return ReadWholeFile(source, data, error);
+    }
+    
+    static bool ReadWholeFile(const FileSource& source, std::vector<uint8_t>& data, std::string& error) {
+        data.resize(static_cast<size_t>(source.Size()));
+        if (!source.Read(0, data.data(), data.size())) {
+            data.clear();
+            error = "Failed to read file";
+            return false;
+        }
+        return true;
     }
 };
 
@@ -308,49 +423,84 @@ private:
 
 // ==================== File Scanner ====================
 
-struct FileInfo {
-    std::string path;
-    std::string name;
-    std::string extension;
-    bool isDirectory;
-    uint64_t size;
-};
-
 class FileScanner : public Napi::AsyncWorker {
 public:
     FileScanner(Napi::Env& env, 
                 const std::vector<std::string>& directories,
-                const std::vector<std::string>& extensions)
+                const std::vector<std::string>& extensions,
+                const ScanOptions& options,
+                const std::vector<SortKey>& sortKeys,
+                const std::string& group)
         : Napi::AsyncWorker(env),
           directories_(directories),
           extensions_(extensions),
+          options_(options),
+          sortKeys_(sortKeys),
+          group_(group),
+          cancelled_(false),
           deferred_(Napi::Promise::Deferred::New(env)) {}
     
     Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 protected:
     void Execute() {
-        for (const auto& dir : directories_) {
-            ScanDirectory(dir);
+        ScanOutput output;
+        WalkDirectories(directories_, extensions_, options_, output);
+        if (output.cancelled) {
+            cancelled_ = true;
+            return;
+        }
+        
+        // 排序只产出排列下标，切换排序方式时 JS 端不需要重新取文件列表
+        WorkStealingPool& pool = WorkStealingPool::Shared();
+        for (SortKey key : sortKeys_) {
+            if (key == SortKey::CaptureTime && captureTimes_.size() != output.files.size()) {
+                captureTimes_ = ReadCaptureTimes(output.files, pool, options_.cancel.get());
+            }
+            if (options_.cancel->IsCancelled()) {
+                cancelled_ = true;
+                return;
+            }
+            orders_.push_back(SortPermutation(output.files, key, &captureTimes_, pool));
+        }
+        
+        if (options_.columnar) {
+            BuildScanColumns(output.files.data(), output.files.size(), columns_);
+        } else {
+            files_ = std::move(output.files);
         }
+        errors_ = std::move(output.errors);
     }
     
     void OnOK() {
         Napi::Env env = Env();
-        Napi::Array results = Napi::Array::New(env, files_.size());
+        Napi::Object response = Napi::Object::New(env);
+        EndScan(group_, options_.cancel);
         
-        for (size_t i = 0; i < files_.size(); i++) {
-            Napi::Object obj = Napi::Object::New(env);
-            obj.Set("path", Napi::String::New(env, files_[i].path));
-            obj.Set("name", Napi::String::New(env, files_[i].name));
-            obj.Set("extension", Napi::String::New(env, files_[i].extension));
-            obj.Set("isDirectory", Napi::Boolean::New(env, files_[i].isDirectory));
-            obj.Set("size", Napi::Number::New(env, static_cast<double>(files_[i].size)));
-            results.Set(static_cast<uint32_t>(i), obj);
+        // 被同组新扫描取代或被 cancelScan 取消，结果不完整，直接丢弃
+        if (cancelled_) {
+            response.Set("files", Napi::Array::New(env, 0));
+            response.Set("cancelled", Napi::Boolean::New(env, true));
+            deferred_.Resolve(response);
+            return;
         }
         
-        Napi::Object response = Napi::Object::New(env);
-        response.Set("files", results);
+        if (options_.columnar) {
+            response.Set("files", ScanColumnsToObject(env, std::move(columns_), options_.stat));
+        } else {
+            response.Set("files", FilesToArray(env));
+        }
+        
+        if (!orders_.empty()) {
+            Napi::Object order = Napi::Object::New(env);
+            for (size_t i = 0; i < sortKeys_.size(); i++) {
+                order.Set(SortKeyName(sortKeys_[i]), ExternalTypedArray<Napi::Uint32Array>(env, std::move(orders_[i])));
+            }
+            response.Set("order", order);
+        }
+        if (!captureTimes_.empty()) {
+            response.Set("captureTime", ExternalTypedArray<Napi::Float64Array>(env, std::move(captureTimes_)));
+        }
         
         if (!errors_.empty()) {
             Napi::Array errorArray = Napi::Array::New(env, errors_.size());
@@ -364,94 +514,41 @@ protected:
     }
     
     void OnError(const Napi::Error& e) {
+        EndScan(group_, options_.cancel);
         deferred_.Reject(e.Value());
     }
 
 private:
+    Napi::Array FilesToArray(Napi::Env env) {
+        Napi::Array results = Napi::Array::New(env, files_.size());
+        
+        for (size_t i = 0; i < files_.size(); i++) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("path", Napi::String::New(env, files_[i].path));
+            obj.Set("name", Napi::String::New(env, files_[i].name));
+            obj.Set("extension", Napi::String::New(env, files_[i].extension));
+            obj.Set("isDirectory", Napi::Boolean::New(env, files_[i].isDirectory));
+            obj.Set("size", Napi::Number::New(env, static_cast<double>(files_[i].size)));
+            if (options_.stat) {
+                obj.Set("mtime", Napi::Number::New(env, files_[i].mtime));
+            }
+            results.Set(static_cast<uint32_t>(i), obj);
+        }
+        return results;
+    }
+    
     std::vector<std::string> directories_;
     std::vector<std::string> extensions_;
+    ScanOptions options_;
+    std::vector<SortKey> sortKeys_;
+    std::string group_;
+    bool cancelled_;
     Napi::Promise::Deferred deferred_;
     std::vector<FileInfo> files_;
+    ScanColumns columns_;
+    std::vector<std::vector<uint32_t>> orders_;
+    std::vector<double> captureTimes_;
     std::vector<std::string> errors_;
-    
-    void ScanDirectory(const std::string& dirPath) {
-#ifdef _WIN32
-        WIN32_FIND_DATAA findData;
-        std::string searchPath = dirPath + "\\*";
-        
-        HANDLE hFind = FindFirstFileA(searchPath.c_str(), &findData);
-        if (hFind == INVALID_HANDLE_VALUE) {
-            errors_.push_back("Cannot open directory: " + dirPath);
-            return;
-        }
-        
-        do {
-            std::string name = findData.cFileName;
-            if (name == "." || name == "..") continue;
-            
-            FileInfo info;
-            info.name = name;
-            info.path = dirPath + "\\" + name;
-            info.isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-            
-            if (!info.isDirectory) {
-                size_t pos = name.find_last_of('.');
-                if (pos != std::string::npos) {
-                    info.extension = name.substr(pos);
-                    std::transform(info.extension.begin(), info.extension.end(), 
-                                  info.extension.begin(), ::tolower);
-                }
-                
-                info.size = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
-                
-                if (extensions_.empty() || 
-                    std::find(extensions_.begin(), extensions_.end(), info.extension) != extensions_.end()) {
-                    files_.push_back(info);
-                }
-            }
-        } while (FindNextFileA(hFind, &findData) != 0);
-        
-        FindClose(hFind);
-#else
-        DIR* dir = opendir(dirPath.c_str());
-        if (!dir) {
-            errors_.push_back("Cannot open directory: " + dirPath);
-            return;
-        }
-        
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            std::string name = entry->d_name;
-            if (name == "." || name == "..") continue;
-            
-            FileInfo info;
-            info.name = name;
-            info.path = dirPath + "/" + name;
-            
-            struct stat st;
-            if (stat(info.path.c_str(), &st) == 0) {
-                info.isDirectory = S_ISDIR(st.st_mode);
-                info.size = st.st_size;
-            }
-            
-            if (!info.isDirectory) {
-                size_t pos = name.find_last_of('.');
-                if (pos != std::string::npos) {
-                    info.extension = name.substr(pos);
-                    std::transform(info.extension.begin(), info.extension.end(), 
-                                  info.extension.begin(), ::tolower);
-                }
-                
-                if (extensions_.empty() || 
-                    std::find(extensions_.begin(), extensions_.end(), info.extension) != extensions_.end()) {
-                    files_.push_back(info);
-                }
-            }
-        }
-        
-        closedir(dir);
-#endif
-    }
 };
 
 // ==================== Exported Functions ====================
@@ -459,8 +556,11 @@ private:
 Napi::Value GenerateThumbnails(const Napi::CallbackInfo& info);
 Napi::Value ReadExifRatings(const Napi::CallbackInfo& info);
 Napi::Value ScanFiles(const Napi::CallbackInfo& info);
+Napi::Value CancelScanGroup(const Napi::CallbackInfo& info);
 extern Napi::Value GetRawPreview(const Napi::CallbackInfo& info);
 extern Napi::Value GetRawPreviewSync(const Napi::CallbackInfo& info);
+extern Napi::Value ListRawPreviews(const Napi::CallbackInfo& info);
+extern Napi::Value GetRawPreviews(const Napi::CallbackInfo& info);
 extern Napi::Value GetWICPreview(const Napi::CallbackInfo& info);
 extern Napi::Value GetWICThumbnail(const Napi::CallbackInfo& info);
 extern Napi::Value DecodeRAWInBackground(const Napi::CallbackInfo& info);
@@ -471,6 +571,12 @@ extern Napi::Value SetCurrentFile(const Napi::CallbackInfo& info);
 extern Napi::Value StartPreload(const Napi::CallbackInfo& info);
 extern Napi::Value StopPreload(const Napi::CallbackInfo& info);
 extern Napi::Value ClearWICCache(const Napi::CallbackInfo& info);
+extern Napi::Value ScanFilesStream(const Napi::CallbackInfo& info);
+extern Napi::Value ScanSnapshot(const Napi::CallbackInfo& info);
+extern Napi::Value WatchDirectories(const Napi::CallbackInfo& info);
+extern Napi::Value UnwatchDirectories(const Napi::CallbackInfo& info);
+extern Napi::Value PairFiles(const Napi::CallbackInfo& info);
+extern Napi::Value ResizeJpeg(const Napi::CallbackInfo& info);
 
 Napi::Value GenerateThumbnails(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
@@ -491,15 +597,34 @@ Napi::Value GenerateThumbnails(const Napi::CallbackInfo& info) {
     int maxWidth = 120;
     int maxHeight = 80;
     int quality = 85;
+    PixelLayout layout = PixelLayout::Rgb;
+    bool parallel = true;
+    std::string cacheDir;
+    uint64_t cacheBytes = 512ull * 1024 * 1024;
     
     if (info.Length() > 1 && info[1].IsObject()) {
         Napi::Object options = info[1].As<Napi::Object>();
         if (options.Has("maxWidth")) maxWidth = options.Get("maxWidth").As<Napi::Number>().Int32Value();
         if (options.Has("maxHeight")) maxHeight = options.Get("maxHeight").As<Napi::Number>().Int32Value();
         if (options.Has("quality")) quality = options.Get("quality").As<Napi::Number>().Int32Value();
+        if (options.Has("format")) {
+            std::string format = options.Get("format").As<Napi::String>().Utf8Value();
+            if (format == "rgba") {
+                layout = PixelLayout::Rgba;
+            } else if (format == "bgra") {
+                layout = PixelLayout::Bgra;
+            } else if (format != "jpeg") {
+                Napi::TypeError::New(env, "format must be 'jpeg', 'rgba' or 'bgra'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+        }
+        if (options.Has("parallel")) parallel = options.Get("parallel").As<Napi::Boolean>().Value();
+        if (options.Has("cacheDir")) cacheDir = options.Get("cacheDir").As<Napi::String>().Utf8Value();
+        if (options.Has("cacheBytes")) cacheBytes = static_cast<uint64_t>(options.Get("cacheBytes").As<Napi::Number>().DoubleValue());
     }
     
-    ThumbnailGenerator* worker = new ThumbnailGenerator(env, paths, maxWidth, maxHeight, quality);
+    ThumbnailGenerator* worker = new ThumbnailGenerator(env, paths, maxWidth, maxHeight, quality, layout, parallel,
+                                                        cacheDir, cacheBytes);
     worker->Queue();
     return worker->GetPromise();
 }
@@ -550,19 +675,74 @@ Napi::Value ScanFiles(const Napi::CallbackInfo& info) {
         }
     }
     
-    FileScanner* worker = new FileScanner(env, directories, extensions);
+    ScanOptions options;
+    std::vector<SortKey> sortKeys;
+    std::string group;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object opts = info[2].As<Napi::Object>();
+        if (opts.Has("recursive")) options.recursive = opts.Get("recursive").ToBoolean();
+        if (opts.Has("maxDepth")) options.maxDepth = opts.Get("maxDepth").As<Napi::Number>().Int32Value();
+        if (opts.Has("threads")) options.threads = opts.Get("threads").As<Napi::Number>().Uint32Value();
+        if (opts.Has("stat")) options.stat = opts.Get("stat").ToBoolean();
+        if (opts.Has("columnar")) options.columnar = opts.Get("columnar").ToBoolean();
+        if (opts.Has("group")) group = opts.Get("group").As<Napi::String>().Utf8Value();
+        if (opts.Has("priority")) options.urgent = opts.Get("priority").As<Napi::String>().Utf8Value() == "high";
+        
+        // sort: 'name' | 'mtime' | 'size' | 'captureTime'，或其数组（一次算出多种顺序）
+        if (opts.Has("sort")) {
+            Napi::Value sortValue = opts.Get("sort");
+            std::vector<std::string> names;
+            if (sortValue.IsArray()) {
+                Napi::Array sortArray = sortValue.As<Napi::Array>();
+                for (uint32_t i = 0; i < sortArray.Length(); i++) {
+                    names.push_back(sortArray.Get(i).As<Napi::String>().Utf8Value());
+                }
+            } else if (sortValue.IsString()) {
+                names.push_back(sortValue.As<Napi::String>().Utf8Value());
+            }
+            for (const auto& name : names) {
+                SortKey key;
+                if (!ParseSortKey(name, key)) {
+                    Napi::TypeError::New(env, "Unknown sort key: " + name).ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                sortKeys.push_back(key);
+                // mtime/size 以及读不到拍摄时间时的回退都依赖元数据，这些排序即使指定 stat: false 也要取
+                if (key != SortKey::Name) options.stat = true;
+            }
+        }
+    }
+    
+    options.cancel = BeginScan(group);
+    
+    FileScanner* worker = new FileScanner(env, directories, extensions, options, sortKeys, group);
     worker->Queue();
     return worker->GetPromise();
 }
 
+// cancelScan(group) -> 是否有扫描被取消
+Napi::Value CancelScanGroup(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected scan group string").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    return Napi::Boolean::New(env, CancelScan(info[0].As<Napi::String>().Utf8Value()));
+}
+
 // ==================== Module Init ====================
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("generateThumbnails", Napi::Function::New(env, GenerateThumbnails));
     exports.Set("readExifRatings", Napi::Function::New(env, ReadExifRatings));
     exports.Set("scanFiles", Napi::Function::New(env, ScanFiles));
+    exports.Set("cancelScan", Napi::Function::New(env, CancelScanGroup));
     exports.Set("getRawPreview", Napi::Function::New(env, GetRawPreview));
     exports.Set("getRawPreviewSync", Napi::Function::New(env, GetRawPreviewSync));
+    exports.Set("listRawPreviews", Napi::Function::New(env, ListRawPreviews));
+    exports.Set("getRawPreviews", Napi::Function::New(env, GetRawPreviews));
     exports.Set("getWICPreview", Napi::Function::New(env, GetWICPreview));
     exports.Set("getWICThumbnail", Napi::Function::New(env, GetWICThumbnail));
     exports.Set("decodeRAWInBackground", Napi::Function::New(env, DecodeRAWInBackground));
@@ -573,6 +753,13 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("startPreload", Napi::Function::New(env, StartPreload));
     exports.Set("stopPreload", Napi::Function::New(env, StopPreload));
     exports.Set("clearWICCache", Napi::Function::New(env, ClearWICCache));
+    exports.Set("scanFilesStream", Napi::Function::New(env, ScanFilesStream));
+    exports.Set("scanSnapshot", Napi::Function::New(env, ScanSnapshot));
+    exports.Set("watchDirectories", Napi::Function::New(env, WatchDirectories));
+    exports.Set("unwatchDirectories", Napi::Function::New(env, UnwatchDirectories));
+    exports.Set("pairFiles", Napi::Function::New(env, PairFiles));
+    exports.Set("resizeJpeg", Napi::Function::New(env, ResizeJpeg));
+    exports.Set("hasLibjpeg", Napi::Boolean::New(env, JpegCodecAvailable()));
     return exports;
 }
 
@@ -4,154 +4,153 @@
 #include <algorithm>
 #include <cstring>
 
-#ifdef _WIN32
-#define NOMINMAX
-#include <windows.h>
-#else
-#include <sys/stat.h>
-#endif
+#include "external_buffer.h"
+#include "image_formats.h"
+#include "jpeg_codec.h"
+#include "preview_index.h"
+#include "preview_locator.h"
+#include "work_pool.h"
 
 struct RawPreviewResult {
     std::vector<uint8_t> data;
     int width;
     int height;
+    int orientation = 1;
+    bool rotated = false;   // 已按 orientation 无损转正，data 与 width/height 为转正后的结果
     bool success;
     std::string error;
 };
 
-static bool IsRawExtension(const std::string& ext) {
-    static const std::vector<std::string> rawExts = {
-        ".cr2", ".cr3", ".nef", ".arw", ".dng", ".raf",
-        ".orf", ".rw2", ".pef", ".srw", ".x3f", ".raw"
-    };
-    std::string lowerExt = ext;
-    std::transform(lowerExt.begin(), lowerExt.end(), lowerExt.begin(), ::tolower);
-    return std::find(rawExts.begin(), rawExts.end(), lowerExt) != rawExts.end();
+// 可选参数 { minEdge, autoRotate, index }
+struct PreviewOptions {
+    int minEdge = 0;        // 取短边不小于 minEdge 的最小预览
+    bool autoRotate = false;
+    std::string indexPath;  // 预览偏移索引文件（每个图库根目录一个），为空时每次都解析容器
+};
+
+// 按扩展名和文件头判断是否可能带内嵌预览；扩展名写错的 RAW 嗅探出 TIFF 容器时同样放行
+static bool HasEmbeddedPreview(ImageFormat format) {
+    return IsRawFormat(format) || format == ImageFormat::Tiff;
 }
 
-static std::string GetExtension(const std::string& path) {
-    size_t pos = path.find_last_of('.');
-    if (pos != std::string::npos) {
-        return path.substr(pos);
-    }
-    return "";
+// 列出内嵌预览阶梯（按像素面积从小到大）；结构中找不到（X3F、MakerNote 内的预览等）时才退回分块扫描
+static bool ListEmbeddedPreviews(const FileSource& source, const std::string& filePath,
+                                 ImageFormat& format, std::vector<EmbeddedPreview>& previews) {
+    format = ResolveFormat(FormatFromPath(filePath), SniffFormat(source.Head(), source.HeadSize()));
+    if (LocateEmbeddedPreviews(source, format, previews) && !previews.empty()) return true;
+    
+    EmbeddedPreview preview;
+    if (!ScanForLargestJpeg(source, preview)) return false;
+    previews.push_back(preview);
+    return true;
 }
 
-#ifdef _WIN32
-static std::wstring Utf8ToWide(const std::string& str) {
-    if (str.empty()) return std::wstring();
-    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
-    std::wstring result(size - 1, 0);
-    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
-    return result;
+// 索引文件可能损坏或与文件内容不符：阶梯为空或有预览越出文件末尾时不能信任，按未命中处理
+static bool PreviewsFitSource(const std::vector<EmbeddedPreview>& previews, uint64_t sourceSize) {
+    if (previews.empty()) return false;
+    for (const auto& p : previews) {
+        if (p.length == 0 || p.offset > sourceSize || p.length > sourceSize - p.offset) return false;
+    }
+    return true;
 }
-#endif
 
-static RawPreviewResult ExtractEmbeddedJpeg(const std::string& filePath) {
+static RawPreviewResult ExtractEmbeddedJpeg(const std::string& filePath, const PreviewOptions& options = {}) {
     RawPreviewResult result;
     result.success = false;
     result.width = 0;
     result.height = 0;
     
-    FILE* file = nullptr;
-#ifdef _WIN32
-    std::wstring widePath = Utf8ToWide(filePath);
-    file = _wfopen(widePath.c_str(), L"rb");
-#else
-    file = fopen(filePath.c_str(), "rb");
-#endif
-    if (!file) {
+    std::shared_ptr<PreviewIndex> index;
+    if (!options.indexPath.empty()) index = PreviewIndex::Open(options.indexPath);
+    
+    // 只读入文件头解析容器结构，预览本身按偏移单独读取，不把整个 RAW 载入内存；
+    // 有索引时先不读文件头，命中后只剩一次定点读取
+    FileSource source;
+    if (!source.Open(filePath, !index)) {
         result.error = "Cannot open file";
         return result;
     }
     
-    fseek(file, 0, SEEK_END);
-    long fileSize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (fileSize < 4) {
-        fclose(file);
+    if (source.Size() < 4) {
         result.error = "File too small";
         return result;
     }
     
-    std::vector<uint8_t> buffer(fileSize);
-    size_t bytesRead = fread(buffer.data(), 1, fileSize, file);
-    fclose(file);
+    std::vector<EmbeddedPreview> previews;
+    if (!index || !index->Lookup(filePath, source.Size(), source.Mtime(), previews) ||
+        !PreviewsFitSource(previews, source.Size())) {
+        previews.clear();
+        if (!source.ReadHead()) {
+            result.error = "Failed to read file";
+            return result;
+        }
+        if (!HasEmbeddedPreview(ResolveFormat(FormatFromPath(filePath), SniffFormat(source.Head(), source.HeadSize())))) {
+            result.error = "Not a RAW file";
+            return result;
+        }
+        
+        ImageFormat format;
+        if (!ListEmbeddedPreviews(source, filePath, format, previews)) {
+            result.error = "No embedded JPEG found";
+            return result;
+        }
+        if (index) index->Store(filePath, source.Size(), source.Mtime(), previews);
+    }
     
-    if (bytesRead != (size_t)fileSize) {
+    const EmbeddedPreview& preview = SelectPreview(previews, options.minEdge);
+    result.data.resize(static_cast<size_t>(preview.length));
+    if (!source.Read(preview.offset, result.data.data(), result.data.size())) {
+        result.data.clear();
         result.error = "Failed to read file";
         return result;
     }
     
-    std::vector<std::pair<size_t, size_t>> jpegList;
-    
-    for (size_t i = 0; i < fileSize - 1; i++) {
-        if (buffer[i] == 0xFF && buffer[i + 1] == 0xD8) {
-            size_t jpegEnd = i + 2;
-            while (jpegEnd < (size_t)fileSize - 1) {
-                if (buffer[jpegEnd] == 0xFF && buffer[jpegEnd + 1] == 0xD9) {
-                    jpegEnd += 2;
-                    size_t jpegSize = jpegEnd - i;
-                    jpegList.push_back({i, jpegSize});
-                    break;
-                }
-                jpegEnd++;
-            }
-        }
-    }
-    
-    size_t jpegStart = 0;
-    size_t largestJpegSize = 0;
-    
-    for (const auto& jpeg : jpegList) {
-        if (jpeg.second > largestJpegSize) {
-            largestJpegSize = jpeg.second;
-            jpegStart = jpeg.first;
-        }
-    }
+    result.width = preview.width;
+    result.height = preview.height;
+    result.orientation = preview.orientation;
+    result.success = true;
     
-    if (largestJpegSize > 0) {
-        result.data.assign(buffer.begin() + jpegStart, 
-                          buffer.begin() + jpegStart + largestJpegSize);
-        result.success = true;
-        
-        for (size_t i = jpegStart; i < jpegStart + largestJpegSize - 8; i++) {
-            if (buffer[i] == 0xFF && (buffer[i+1] & 0xF0) == 0xC0 && buffer[i+1] != 0xC4) {
-                if (i + 8 < jpegStart + largestJpegSize) {
-                    result.height = (buffer[i+5] << 8) | buffer[i+6];
-                    result.width = (buffer[i+7] << 8) | buffer[i+8];
-                    break;
-                }
-            }
+    // DCT 域无损转正；未启用 libjpeg 或转换失败时保留原图，由调用方按 orientation 处理
+    if (options.autoRotate && preview.orientation > 1) {
+        std::vector<uint8_t> rotated;
+        int width, height;
+        std::string error;
+        if (TransformJpeg(result.data.data(), result.data.size(), preview.orientation, rotated, width, height, error)) {
+            result.data = std::move(rotated);
+            result.width = width;
+            result.height = height;
+            result.rotated = true;
         }
-    } else {
-        result.error = "No embedded JPEG found";
     }
-    
     return result;
 }
 
+static PreviewOptions ParsePreviewOptions(const Napi::CallbackInfo& info) {
+    PreviewOptions options;
+    if (info.Length() < 2 || !info[1].IsObject()) return options;
+    Napi::Object obj = info[1].As<Napi::Object>();
+    Napi::Value minEdge = obj.Get("minEdge");
+    if (minEdge.IsNumber()) options.minEdge = minEdge.As<Napi::Number>().Int32Value();
+    Napi::Value autoRotate = obj.Get("autoRotate");
+    if (autoRotate.IsBoolean()) options.autoRotate = autoRotate.As<Napi::Boolean>().Value();
+    Napi::Value index = obj.Get("index");
+    if (index.IsString()) options.indexPath = index.As<Napi::String>().Utf8Value();
+    return options;
+}
+
 class RawPreviewWorker : public Napi::AsyncWorker {
 public:
-    RawPreviewWorker(Napi::Env& env, const std::string& filePath)
+    RawPreviewWorker(Napi::Env& env, const std::string& filePath, const PreviewOptions& options)
         : Napi::AsyncWorker(env),
           filePath_(filePath),
+          options_(options),
           deferred_(Napi::Promise::Deferred::New(env)) {}
     
     Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 protected:
     void Execute() {
-        std::string ext = GetExtension(filePath_);
-        
-        if (!IsRawExtension(ext)) {
-            result_.success = false;
-            result_.error = "Not a RAW file";
-            return;
-        }
-        
-        result_ = ExtractEmbeddedJpeg(filePath_);
+        result_ = ExtractEmbeddedJpeg(filePath_, options_);
     }
     
     void OnOK() {
@@ -161,11 +160,11 @@ protected:
         obj.Set("success", Napi::Boolean::New(env, result_.success));
         obj.Set("width", Napi::Number::New(env, result_.width));
         obj.Set("height", Napi::Number::New(env, result_.height));
+        obj.Set("orientation", Napi::Number::New(env, result_.orientation));
+        obj.Set("rotated", Napi::Boolean::New(env, result_.rotated));
         
         if (result_.success && !result_.data.empty()) {
-            Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                env, result_.data.data(), result_.data.size());
-            obj.Set("data", buffer);
+            obj.Set("data", ExternalBuffer(env, std::move(result_.data)));
         }
         
         if (!result_.error.empty()) {
@@ -181,6 +180,7 @@ protected:
 
 private:
     std::string filePath_;
+    PreviewOptions options_;
     RawPreviewResult result_;
     Napi::Promise::Deferred deferred_;
 };
@@ -195,7 +195,7 @@ Napi::Value GetRawPreview(const Napi::CallbackInfo& info) {
     
     std::string filePath = info[0].As<Napi::String>().Utf8Value();
     
-    RawPreviewWorker* worker = new RawPreviewWorker(env, filePath);
+    RawPreviewWorker* worker = new RawPreviewWorker(env, filePath, ParsePreviewOptions(info));
     worker->Queue();
     return worker->GetPromise();
 }
@@ -210,25 +210,17 @@ Napi::Value GetRawPreviewSync(const Napi::CallbackInfo& info) {
     
     std::string filePath = info[0].As<Napi::String>().Utf8Value();
     
-    std::string ext = GetExtension(filePath);
-    if (!IsRawExtension(ext)) {
-        Napi::Object obj = Napi::Object::New(env);
-        obj.Set("success", Napi::Boolean::New(env, false));
-        obj.Set("error", Napi::String::New(env, "Not a RAW file"));
-        return obj;
-    }
-    
-    RawPreviewResult result = ExtractEmbeddedJpeg(filePath);
+    RawPreviewResult result = ExtractEmbeddedJpeg(filePath, ParsePreviewOptions(info));
     
     Napi::Object obj = Napi::Object::New(env);
     obj.Set("success", Napi::Boolean::New(env, result.success));
     obj.Set("width", Napi::Number::New(env, result.width));
     obj.Set("height", Napi::Number::New(env, result.height));
+    obj.Set("orientation", Napi::Number::New(env, result.orientation));
+    obj.Set("rotated", Napi::Boolean::New(env, result.rotated));
     
     if (result.success && !result.data.empty()) {
-        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-            env, result.data.data(), result.data.size());
-        obj.Set("data", buffer);
+        obj.Set("data", ExternalBuffer(env, std::move(result.data)));
     }
     
     if (!result.error.empty()) {
@@ -237,3 +229,177 @@ Napi::Value GetRawPreviewSync(const Napi::CallbackInfo& info) {
     
     return obj;
 }
+
+class RawPreviewLadderWorker : public Napi::AsyncWorker {
+public:
+    RawPreviewLadderWorker(Napi::Env& env, const std::string& filePath)
+        : Napi::AsyncWorker(env),
+          filePath_(filePath),
+          format_(ImageFormat::Unknown),
+          deferred_(Napi::Promise::Deferred::New(env)) {}
+    
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute() {
+        FileSource source;
+        if (!source.Open(filePath_)) {
+            error_ = "Cannot open file";
+            return;
+        }
+        if (!ListEmbeddedPreviews(source, filePath_, format_, previews_)) {
+            error_ = "No embedded JPEG found";
+        }
+    }
+    
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("success", Napi::Boolean::New(env, error_.empty()));
+        obj.Set("format", Napi::String::New(env, ImageFormatName(format_)));
+        
+        Napi::Array list = Napi::Array::New(env, previews_.size());
+        for (size_t i = 0; i < previews_.size(); i++) {
+            const EmbeddedPreview& p = previews_[i];
+            Napi::Object item = Napi::Object::New(env);
+            item.Set("offset", Napi::Number::New(env, static_cast<double>(p.offset)));
+            item.Set("length", Napi::Number::New(env, static_cast<double>(p.length)));
+            item.Set("width", Napi::Number::New(env, p.width));
+            item.Set("height", Napi::Number::New(env, p.height));
+            item.Set("orientation", Napi::Number::New(env, p.orientation));
+            list.Set(static_cast<uint32_t>(i), item);
+        }
+        obj.Set("previews", list);
+        
+        if (!error_.empty()) {
+            obj.Set("error", Napi::String::New(env, error_));
+        }
+        deferred_.Resolve(obj);
+    }
+    
+    void OnError(const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    std::string filePath_;
+    ImageFormat format_;
+    std::vector<EmbeddedPreview> previews_;
+    std::string error_;
+    Napi::Promise::Deferred deferred_;
+};
+
+// 列出文件中全部内嵌预览（offset、length、width、height、orientation），按像素面积从小到大
+Napi::Value ListRawPreviews(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected file path string").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    std::string filePath = info[0].As<Napi::String>().Utf8Value();
+    
+    RawPreviewLadderWorker* worker = new RawPreviewLadderWorker(env, filePath);
+    worker->Queue();
+    return worker->GetPromise();
+}
+
+// 批量提取专用线程池：与扫描共用的 Shared() 分开，线程数取核数的两倍，
+// 让后续文件的文件头读取与前面文件的解析、拷贝相互重叠
+static WorkStealingPool& RawPreviewPool() {
+    static WorkStealingPool pool(WorkStealingPool::DefaultThreadCount() * 2);
+    return pool;
+}
+
+// 批量提取：各文件在线程池上并行处理，完成一个就把下标投递给 JS，结果按完成顺序到达
+class RawPreviewBatchWorker : public Napi::AsyncProgressQueueWorker<uint32_t> {
+public:
+    RawPreviewBatchWorker(const Napi::Function& onResult, std::vector<std::string>&& paths, const PreviewOptions& options)
+        : Napi::AsyncProgressQueueWorker<uint32_t>(onResult),
+          paths_(std::move(paths)),
+          results_(paths_.size()),
+          options_(options),
+          succeeded_(0),
+          deferred_(Napi::Promise::Deferred::New(onResult.Env())) {}
+    
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute(const ExecutionProgress& progress) {
+        TaskGroup group(RawPreviewPool());
+        for (uint32_t i = 0; i < paths_.size(); i++) {
+            group.Run([this, &progress, i]() {
+                results_[i] = ExtractEmbeddedJpeg(paths_[i], options_);
+                progress.Send(&i, 1);
+            });
+        }
+    }
+    
+    void OnProgress(const uint32_t* indices, size_t count) {
+        Napi::Env env = Env();
+        for (size_t k = 0; k < count; k++) {
+            uint32_t i = indices[k];
+            RawPreviewResult& result = results_[i];
+            
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("index", Napi::Number::New(env, i));
+            obj.Set("path", Napi::String::New(env, paths_[i]));
+            obj.Set("success", Napi::Boolean::New(env, result.success));
+            obj.Set("width", Napi::Number::New(env, result.width));
+            obj.Set("height", Napi::Number::New(env, result.height));
+            obj.Set("orientation", Napi::Number::New(env, result.orientation));
+            obj.Set("rotated", Napi::Boolean::New(env, result.rotated));
+            if (result.success && !result.data.empty()) {
+                obj.Set("data", ExternalBuffer(env, std::move(result.data)));
+                succeeded_++;
+            }
+            if (!result.error.empty()) {
+                obj.Set("error", Napi::String::New(env, result.error));
+            }
+            
+            Callback().Call({obj});
+        }
+    }
+    
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object response = Napi::Object::New(env);
+        response.Set("total", Napi::Number::New(env, static_cast<double>(paths_.size())));
+        response.Set("succeeded", Napi::Number::New(env, static_cast<double>(succeeded_)));
+        deferred_.Resolve(response);
+    }
+    
+    void OnError(const Napi::Error& e) {
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    std::vector<std::string> paths_;
+    std::vector<RawPreviewResult> results_;
+    PreviewOptions options_;
+    size_t succeeded_;
+    Napi::Promise::Deferred deferred_;
+};
+
+// getRawPreviews(paths, options, onResult)
+Napi::Value GetRawPreviews(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 3 || !info[0].IsArray() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (paths, options, onResult)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    Napi::Array pathArray = info[0].As<Napi::Array>();
+    std::vector<std::string> paths;
+    paths.reserve(pathArray.Length());
+    for (uint32_t i = 0; i < pathArray.Length(); i++) {
+        paths.push_back(pathArray.Get(i).As<Napi::String>().Utf8Value());
+    }
+    
+    RawPreviewBatchWorker* worker = new RawPreviewBatchWorker(
+        info[2].As<Napi::Function>(), std::move(paths), ParsePreviewOptions(info));
+    worker->Queue();
+    return worker->GetPromise();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <napi.h>
+
+#include "dir_walker.h"
+#include "external_buffer.h"
+
+// 列式结果转 JS：各列为外部内存支撑的定型数组，JS 端按下标惰性解码
+// { columnar: true, count, pathData, pathOffsets, nameOffsets, extensionIds, extensions, size, mtime?, flags }
+inline Napi::Object ScanColumnsToObject(Napi::Env env, ScanColumns&& columns, bool withStat) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("columnar", Napi::Boolean::New(env, true));
+    result.Set("count", Napi::Number::New(env, static_cast<double>(columns.Count())));
+
+    Napi::Array extensions = Napi::Array::New(env, columns.extensions.size());
+    for (size_t i = 0; i < columns.extensions.size(); i++) {
+        extensions.Set(static_cast<uint32_t>(i), Napi::String::New(env, columns.extensions[i]));
+    }
+    result.Set("extensions", extensions);
+
+    result.Set("pathData", ExternalTypedArray<Napi::Uint8Array>(env, std::move(columns.pathData)));
+    result.Set("pathOffsets", ExternalTypedArray<Napi::Uint32Array>(env, std::move(columns.pathOffsets)));
+    result.Set("nameOffsets", ExternalTypedArray<Napi::Uint32Array>(env, std::move(columns.nameOffsets)));
+    result.Set("extensionIds", ExternalTypedArray<Napi::Uint8Array>(env, std::move(columns.extensionIds)));
+    result.Set("size", ExternalTypedArray<Napi::Float64Array>(env, std::move(columns.size)));
+    if (withStat) {
+        result.Set("mtime", ExternalTypedArray<Napi::Float64Array>(env, std::move(columns.mtime)));
+    }
+    result.Set("flags", ExternalTypedArray<Napi::Uint8Array>(env, std::move(columns.flags)));
+
+    return result;
+}
@@ -0,0 +1,162 @@
+#include <napi.h>
+#include <vector>
+#include <string>
+
+#include "dir_walker.h"
+#include "scan_columns.h"
+#include "work_pool.h"
+
+// 流式扫描：遍历进行中按批把结果推给 JS 回调，Promise 在最后一批送达之后才 resolve
+class StreamingScanner : public Napi::AsyncProgressQueueWorker<FileInfo> {
+public:
+    StreamingScanner(const Napi::Function& onBatch,
+                     const std::vector<std::string>& directories,
+                     const std::vector<std::string>& extensions,
+                     const ScanOptions& options,
+                     size_t batchSize,
+                     int intervalMs,
+                     const std::string& group)
+        : Napi::AsyncProgressQueueWorker<FileInfo>(onBatch),
+          directories_(directories),
+          extensions_(extensions),
+          options_(options),
+          batchSize_(batchSize),
+          intervalMs_(intervalMs),
+          group_(group),
+          total_(0),
+          cancelled_(false),
+          deferred_(Napi::Promise::Deferred::New(onBatch.Env())) {}
+
+    Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+protected:
+    void Execute(const ExecutionProgress& progress) {
+        ScanSink sink([&progress](std::vector<FileInfo>&& batch) {
+            progress.Send(batch.data(), batch.size());
+        }, batchSize_, intervalMs_);
+
+        ScanOutput output;
+        WalkDirectories(directories_, extensions_, options_, output, &sink);
+
+        total_ = sink.Total();
+        cancelled_ = output.cancelled;
+        errors_ = std::move(output.errors);
+    }
+
+    void OnProgress(const FileInfo* files, size_t count) {
+        Napi::Env env = Env();
+        // 已取消的扫描不再向 JS 投递排队中的批次
+        if (options_.cancel->IsCancelled()) return;
+
+        if (options_.columnar) {
+            ScanColumns columns;
+            BuildScanColumns(files, count, columns);
+            Callback().Call({ScanColumnsToObject(env, std::move(columns), options_.stat)});
+            return;
+        }
+
+        Napi::Array batch = Napi::Array::New(env, count);
+
+        for (size_t i = 0; i < count; i++) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("path", Napi::String::New(env, files[i].path));
+            obj.Set("name", Napi::String::New(env, files[i].name));
+            obj.Set("extension", Napi::String::New(env, files[i].extension));
+            obj.Set("isDirectory", Napi::Boolean::New(env, files[i].isDirectory));
+            obj.Set("size", Napi::Number::New(env, static_cast<double>(files[i].size)));
+            if (options_.stat) {
+                obj.Set("mtime", Napi::Number::New(env, files[i].mtime));
+            }
+            batch.Set(static_cast<uint32_t>(i), obj);
+        }
+
+        Callback().Call({batch});
+    }
+
+    void OnOK() {
+        Napi::Env env = Env();
+        Napi::Object response = Napi::Object::New(env);
+        EndScan(group_, options_.cancel);
+        response.Set("total", Napi::Number::New(env, static_cast<double>(total_)));
+        if (cancelled_) {
+            response.Set("cancelled", Napi::Boolean::New(env, true));
+        }
+
+        if (!errors_.empty()) {
+            Napi::Array errorArray = Napi::Array::New(env, errors_.size());
+            for (size_t i = 0; i < errors_.size(); i++) {
+                errorArray.Set(static_cast<uint32_t>(i), Napi::String::New(env, errors_[i]));
+            }
+            response.Set("errors", errorArray);
+        }
+
+        deferred_.Resolve(response);
+    }
+
+    void OnError(const Napi::Error& e) {
+        EndScan(group_, options_.cancel);
+        deferred_.Reject(e.Value());
+    }
+
+private:
+    std::vector<std::string> directories_;
+    std::vector<std::string> extensions_;
+    ScanOptions options_;
+    size_t batchSize_;
+    int intervalMs_;
+    std::string group_;
+    size_t total_;
+    bool cancelled_;
+    std::vector<std::string> errors_;
+    Napi::Promise::Deferred deferred_;
+};
+
+// scanFilesStream(directories, extensions, options, onBatch)
+Napi::Value ScanFilesStream(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4 || !info[0].IsArray() || !info[3].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (directories, extensions, options, onBatch)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Array dirsArray = info[0].As<Napi::Array>();
+    std::vector<std::string> directories;
+    directories.reserve(dirsArray.Length());
+
+    for (uint32_t i = 0; i < dirsArray.Length(); i++) {
+        directories.push_back(dirsArray.Get(i).As<Napi::String>().Utf8Value());
+    }
+
+    std::vector<std::string> extensions;
+    if (info[1].IsArray()) {
+        Napi::Array extArray = info[1].As<Napi::Array>();
+        extensions.reserve(extArray.Length());
+        for (uint32_t i = 0; i < extArray.Length(); i++) {
+            extensions.push_back(extArray.Get(i).As<Napi::String>().Utf8Value());
+        }
+    }
+
+    ScanOptions options;
+    size_t batchSize = 512;
+    int intervalMs = 16;
+    std::string group;
+    if (info[2].IsObject()) {
+        Napi::Object opts = info[2].As<Napi::Object>();
+        if (opts.Has("recursive")) options.recursive = opts.Get("recursive").ToBoolean();
+        if (opts.Has("maxDepth")) options.maxDepth = opts.Get("maxDepth").As<Napi::Number>().Int32Value();
+        if (opts.Has("threads")) options.threads = opts.Get("threads").As<Napi::Number>().Uint32Value();
+        if (opts.Has("stat")) options.stat = opts.Get("stat").ToBoolean();
+        if (opts.Has("columnar")) options.columnar = opts.Get("columnar").ToBoolean();
+        if (opts.Has("batchSize")) batchSize = opts.Get("batchSize").As<Napi::Number>().Uint32Value();
+        if (opts.Has("intervalMs")) intervalMs = opts.Get("intervalMs").As<Napi::Number>().Int32Value();
+        if (opts.Has("group")) group = opts.Get("group").As<Napi::String>().Utf8Value();
+        if (opts.Has("priority")) options.urgent = opts.Get("priority").As<Napi::String>().Utf8Value() == "high";
+    }
+    options.cancel = BeginScan(group);
+
+    StreamingScanner* worker = new StreamingScanner(
+        info[3].As<Napi::Function>(), directories, extensions, options, batchSize, intervalMs, group);
+    worker->Queue();
+    return worker->GetPromise();
+}
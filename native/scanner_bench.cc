@@ -0,0 +1,222 @@
+// 扫描器基准程序：生成合成照片目录树，在各模式下运行 WalkDirectories，输出 files/sec 与系统调用计数。
+// 构建：node-gyp rebuild --directory=native 后运行 native/build/Release/scanner_bench
+//
+//   scanner_bench [--root DIR] [--breadth N] [--depth N] [--files N] [--flat-files N]
+//                 [--iterations N] [--threads N] [--reuse] [--keep]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "dir_walker.h"
+
+namespace fs = std::filesystem;
+
+struct BenchConfig {
+    std::string root;
+    int breadth = 4;            // 每个目录的子目录数
+    int depth = 3;              // 目录树深度（0 表示只有根目录）
+    int files = 250;            // 每个目录的 JPG/RAW 对数
+    int flatFiles = 20000;      // 平铺目录中的 JPG/RAW 对数
+    int iterations = 5;
+    unsigned threads = 0;
+    bool reuse = false;
+    bool keep = false;
+};
+
+struct BenchResult {
+    size_t files = 0;
+    double bestMs = 0;
+    double medianMs = 0;
+    ScanStats stats;
+};
+
+static void WriteStub(const fs::path& path, const char* header, size_t length) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(header, static_cast<std::streamsize>(length));
+}
+
+// 每个目录写入 files 对 IMG_xxxxx.JPG/.CR3，再加少量 .xmp 旁车文件用于检验扩展名过滤
+static size_t FillDirectory(const fs::path& dir, int files, size_t& counter) {
+    static const char jpegHeader[] = "\xFF\xD8\xFF\xE0";
+    static const char cr3Header[] = "\x00\x00\x00\x18" "ftypcrx ";
+
+    fs::create_directories(dir);
+    size_t written = 0;
+    char name[32];
+    for (int i = 0; i < files; i++) {
+        snprintf(name, sizeof(name), "IMG_%05zu", counter++);
+        WriteStub(dir / (std::string(name) + ".JPG"), jpegHeader, 4);
+        WriteStub(dir / (std::string(name) + ".CR3"), cr3Header, 12);
+        if (i % 10 == 0) WriteStub(dir / (std::string(name) + ".xmp"), "<x/>", 4);
+        written += 2;
+    }
+    return written;
+}
+
+static size_t GenerateTree(const fs::path& dir, const BenchConfig& config, int level, size_t& counter, size_t& dirs) {
+    size_t written = FillDirectory(dir, config.files, counter);
+    dirs++;
+    if (level < config.depth) {
+        char name[32];
+        for (int b = 0; b < config.breadth; b++) {
+            snprintf(name, sizeof(name), "%03d_DCIM", b);
+            written += GenerateTree(dir / name, config, level + 1, counter, dirs);
+        }
+    }
+    return written;
+}
+
+template <typename Fn>
+static BenchResult Measure(int iterations, Fn run) {
+    BenchResult result;
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        ResetScanStats();
+        auto start = std::chrono::steady_clock::now();
+        result.files = run();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        result.stats = GetScanStats();
+    }
+    std::sort(times.begin(), times.end());
+    result.bestMs = times.front();
+    result.medianMs = times[times.size() / 2];
+    return result;
+}
+
+static void PrintResult(const char* mode, const BenchResult& r) {
+    double filesPerSec = r.bestMs > 0 ? r.files / (r.bestMs / 1000.0) : 0;
+    printf("%-22s %9zu %10.2f %10.2f %12.0f %9llu %11llu %9llu\n",
+           mode, r.files, r.bestMs, r.medianMs, filesPerSec,
+           static_cast<unsigned long long>(r.stats.dirOpens),
+           static_cast<unsigned long long>(r.stats.dirEntries),
+           static_cast<unsigned long long>(r.stats.statCalls));
+}
+
+static bool ParseArgs(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&](int& value) {
+            if (i + 1 >= argc) return false;
+            value = atoi(argv[++i]);
+            return true;
+        };
+
+        if (arg == "--root" && i + 1 < argc) config.root = argv[++i];
+        else if (arg == "--breadth") { if (!next(config.breadth)) return false; }
+        else if (arg == "--depth") { if (!next(config.depth)) return false; }
+        else if (arg == "--files") { if (!next(config.files)) return false; }
+        else if (arg == "--flat-files") { if (!next(config.flatFiles)) return false; }
+        else if (arg == "--iterations") { if (!next(config.iterations)) return false; }
+        else if (arg == "--threads") {
+            int threads = 0;
+            if (!next(threads)) return false;
+            config.threads = threads > 0 ? static_cast<unsigned>(threads) : 0;
+        }
+        else if (arg == "--reuse") config.reuse = true;
+        else if (arg == "--keep") config.keep = true;
+        else return false;
+    }
+    if (config.iterations < 1) config.iterations = 1;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!ParseArgs(argc, argv, config)) {
+        fprintf(stderr,
+                "usage: scanner_bench [--root DIR] [--breadth N] [--depth N] [--files N] [--flat-files N]\n"
+                "                     [--iterations N] [--threads N] [--reuse] [--keep]\n");
+        return 2;
+    }
+
+    fs::path root = config.root.empty() ? fs::temp_directory_path() / "qp_scan_bench" : fs::path(config.root);
+    fs::path treeDir = root / "tree";
+    fs::path flatDir = root / "flat";
+
+    // 只创建和删除自己的 tree/flat 子目录；root 里有其他内容时拒绝运行，避免误删用户文件
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name != "tree" && name != "flat") {
+            fprintf(stderr, "%s is not empty and was not created by scanner_bench; pick another --root\n",
+                    root.string().c_str());
+            return 1;
+        }
+    }
+    ec.clear();
+
+    if (!config.reuse || !fs::exists(treeDir, ec)) {
+        fs::remove_all(treeDir, ec);
+        fs::remove_all(flatDir, ec);
+
+        auto start = std::chrono::steady_clock::now();
+        size_t counter = 0, dirs = 0;
+        size_t treeFiles = GenerateTree(treeDir, config, 0, counter, dirs);
+        size_t flatFiles = FillDirectory(flatDir, config.flatFiles, counter);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        printf("generated %zu dirs / %zu photo files in tree, %zu in flat dir (%.0f ms) at %s\n",
+               dirs, treeFiles, flatFiles, ms, root.string().c_str());
+    } else {
+        printf("reusing %s\n", root.string().c_str());
+    }
+
+    const std::vector<std::string> extensions = {".jpg", ".cr3"};
+    const std::vector<std::string> flatRoots = {flatDir.string()};
+    const std::vector<std::string> treeRoots = {treeDir.string()};
+
+    ScanOptions flat;
+    flat.threads = config.threads;
+
+    ScanOptions recursive = flat;
+    recursive.recursive = true;
+
+    ScanOptions statFree = recursive;
+    statFree.stat = false;
+
+    auto scan = [&extensions](const std::vector<std::string>& roots, const ScanOptions& options) {
+        ScanOutput output;
+        WalkDirectories(roots, extensions, options, output);
+        return output.files.size();
+    };
+    auto stream = [&extensions](const std::vector<std::string>& roots, const ScanOptions& options) {
+        size_t batches = 0;
+        ScanSink sink([&batches](std::vector<FileInfo>&&) { batches++; });
+        ScanOutput output;
+        WalkDirectories(roots, extensions, options, output, &sink);
+        return sink.Total();
+    };
+
+    printf("\n%-22s %9s %10s %10s %12s %9s %11s %9s\n",
+           "mode", "files", "best ms", "median ms", "files/sec", "opens", "dirents", "stats");
+
+    PrintResult("flat", Measure(config.iterations, [&] { return scan(flatRoots, flat); }));
+    PrintResult("flat stat-free", Measure(config.iterations, [&] {
+        ScanOptions options = flat;
+        options.stat = false;
+        return scan(flatRoots, options);
+    }));
+    PrintResult("recursive", Measure(config.iterations, [&] { return scan(treeRoots, recursive); }));
+    PrintResult("recursive stat-free", Measure(config.iterations, [&] { return scan(treeRoots, statFree); }));
+    PrintResult("streaming", Measure(config.iterations, [&] { return stream(treeRoots, recursive); }));
+    PrintResult("streaming stat-free", Measure(config.iterations, [&] { return stream(treeRoots, statFree); }));
+
+    if (GetScanStats().dirOpens == 0) {
+        printf("\n(syscall counts need a build with QP_SCAN_STATS defined)\n");
+    }
+
+    if (!config.keep && !config.reuse) {
+        fs::remove_all(treeDir, ec);
+        fs::remove_all(flatDir, ec);
+        fs::remove(root, ec);   // 只在已为空时删除
+    }
+    return 0;
+}
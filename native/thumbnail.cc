@@ -2,6 +2,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstring>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -9,12 +10,21 @@
 #include <sys/stat.h>
 #endif
 
+#include "external_buffer.h"
+#include "image_formats.h"
+#include "jpeg_codec.h"
+#include "jpeg_thumbnail.h"
+#include "preview_locator.h"
+#include "thumbnail_cache.h"
+#include "work_pool.h"
+
 struct ThumbnailResult {
     std::string path;
     std::vector<uint8_t> data;
     int width;
     int height;
     bool success;
+    bool cached;
     std::string error;
 };
 
@@ -24,40 +34,47 @@ public:
                        const std::vector<std::string>& paths,
                        int maxWidth,
                        int maxHeight,
-                       int quality)
+                       int quality,
+                       PixelLayout layout,
+                       bool parallel,
+                       const std::string& cacheDir,
+                       uint64_t cacheBytes)
         : Napi::AsyncWorker(env),
           paths_(paths),
           maxWidth_(maxWidth),
           maxHeight_(maxHeight),
           quality_(quality),
+          layout_(layout),
+          parallel_(parallel),
+          cacheDir_(cacheDir),
+          cacheBytes_(cacheBytes),
           deferred_(Napi::Promise::Deferred::New(env)) {}
     
     Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 protected:
     void Execute() {
-        results_.reserve(paths_.size());
+        // 首次打开要读索引，放在工作线程；同一目录进程内只加载一次
+        if (!cacheDir_.empty()) {
+            cache_ = ThumbnailCache::Open(cacheDir_, cacheBytes_);
+        }
+        results_.resize(paths_.size());
         
-        for (size_t i = 0; i < paths_.size(); i++) {
-            ThumbnailResult result;
-            result.path = paths_[i];
-            result.success = false;
-            
-            std::string ext = GetExtension(paths_[i]);
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            
-            if (ext == ".jpg" || ext == ".jpeg") {
-                result = GenerateJpegThumbnail(paths_[i]);
-            } else if (ext == ".png") {
-                result = GeneratePngThumbnail(paths_[i]);
-            } else if (IsRawFile(ext)) {
-                result.error = "RAW format requires libraw library";
-            } else {
-                result.error = "Unsupported format";
+        // 每张图写入自己的下标，结果顺序与请求一致；单张时不值得分发
+        if (!parallel_ || paths_.size() < 2) {
+            for (size_t i = 0; i < paths_.size(); i++) {
+                results_[i] = GenerateThumbnail(paths_[i]);
             }
-            
-            results_.push_back(result);
+            return;
+        }
+        
+        TaskGroup group(WorkStealingPool::Shared());
+        for (size_t i = 0; i < paths_.size(); i++) {
+            group.Run([this, i]() {
+                results_[i] = GenerateThumbnail(paths_[i]);
+            });
         }
+        group.Wait();
     }
     
     void OnOK() {
@@ -70,11 +87,15 @@ protected:
             obj.Set("width", Napi::Number::New(env, results_[i].width));
             obj.Set("height", Napi::Number::New(env, results_[i].height));
             obj.Set("success", Napi::Boolean::New(env, results_[i].success));
+            obj.Set("cached", Napi::Boolean::New(env, results_[i].cached));
             
             if (results_[i].success && !results_[i].data.empty()) {
-                Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                    env, results_[i].data.data(), results_[i].data.size());
-                obj.Set("data", buffer);
+                if (layout_ == PixelLayout::Rgb) {
+                    obj.Set("data", ExternalBuffer(env, std::move(results_[i].data)));
+                } else {
+                    obj.Set("data", ExternalClampedArray(env, std::move(results_[i].data)));
+                }
+                obj.Set("format", Napi::String::New(env, FormatName(layout_)));
             }
             
             if (!results_[i].error.empty()) {
@@ -96,54 +117,146 @@ private:
     int maxWidth_;
     int maxHeight_;
     int quality_;
+    PixelLayout layout_;        // Rgb 表示输出 JPEG，Rgba/Bgra 输出转正后的像素
+    bool parallel_;
+    std::string cacheDir_;
+    uint64_t cacheBytes_;
+    std::shared_ptr<ThumbnailCache> cache_;     // 未指定 cacheDir 时为空
     Napi::Promise::Deferred deferred_;
     std::vector<ThumbnailResult> results_;
     
-    std::string GetExtension(const std::string& path) {
-        size_t pos = path.find_last_of('.');
-        if (pos != std::string::npos) {
-            return path.substr(pos);
+    ThumbnailResult GenerateThumbnail(const std::string& path) {
+        ImageFormat format = DetectImageFormat(path);
+        if (format == ImageFormat::Jpeg) {
+            return GenerateJpegThumbnail(path);
         }
-        return "";
-    }
-    
-    bool IsRawFile(const std::string& ext) {
-        static const std::vector<std::string> rawExts = {
-            ".cr2", ".cr3", ".nef", ".arw", ".dng", ".raf", 
-            ".orf", ".rw2", ".pef", ".srw", ".x3f", ".raw"
-        };
-        return std::find(rawExts.begin(), rawExts.end(), ext) != rawExts.end();
+        if (format == ImageFormat::Png) {
+            return GeneratePngThumbnail(path);
+        }
+        
+        ThumbnailResult result;
+        result.path = path;
+        result.success = false;
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
+        result.error = IsRawFormat(format) ? "RAW format requires libraw library" : "Unsupported format";
+        return result;
     }
     
     ThumbnailResult GenerateJpegThumbnail(const std::string& path) {
         ThumbnailResult result;
         result.path = path;
         result.success = false;
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
         
-        FILE* file = fopen(path.c_str(), "rb");
-        if (!file) {
-            result.error = "Cannot open file";
+        // 未启用 libjpeg 时原样返回，由渲染端解码；像素输出无从谈起
+        if (!JpegCodecAvailable() && layout_ != PixelLayout::Rgb) {
+            result.error = "Pixel output requires libjpeg";
+            return result;
+        }
+        if (!JpegCodecAvailable()) {
+            // 宽高取文件头里的实际尺寸，读不到时为 0，不能冒充请求的框
+            result.success = ReadWholeFile(path, result.data, result.error);
+            MemorySource memory(result.data.data(), result.data.size());
+            if (result.success && !ReadJpegDimensions(memory, 0, result.data.size(), result.width, result.height)) {
+                result.width = 0;
+                result.height = 0;
+            }
             return result;
         }
         
-        fseek(file, 0, SEEK_END);
-        long fileSize = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        std::vector<uint8_t> fileData(fileSize);
-        fread(fileData.data(), 1, fileSize, file);
-        fclose(file);
+        FileSource source;
+        if (!source.Open(path, false)) {
+            result.error = "Cannot open file";
+            return result;
+        }
         
-        result.data = std::move(fileData);
-        result.success = true;
-        result.width = maxWidth_;
-        result.height = maxHeight_;
+        // 磁盘缓存按 (路径, 大小, mtime, 目标尺寸, 质量) 命中，直接返回上次的编码结果
+        ThumbnailCacheKey key;
+        if (cache_) {
+            key = {path, source.Size(), source.Mtime(), maxWidth_, maxHeight_, quality_, static_cast<int>(layout_)};
+            if (cache_->Lookup(key, result.data, result.width, result.height)) {
+                result.success = true;
+                result.cached = true;
+                return result;
+            }
+        }
         
+        // 解码器、编码器与读文件缓冲都取当前线程的上下文，跨图片复用
+        ThumbnailContext& context = ThumbnailContext::ForThread();
+        std::vector<uint8_t>& fileData = context.FileBuffer();
+        int width, height;
+        bool ok = ReadWholeFile(source, fileData, result.error);
+        if (ok && layout_ == PixelLayout::Rgb) {
+            ok = context.Make(fileData.data(), fileData.size(), maxWidth_, maxHeight_, quality_,
+                              result.data, width, height, result.error);
+        } else if (ok) {
+            ok = context.MakePixels(fileData.data(), fileData.size(), maxWidth_, maxHeight_, layout_,
+                                    result.data, width, height, result.error);
+        }
+        if (ok) {
+            result.width = width;
+            result.height = height;
+            result.success = true;
+            if (cache_) cache_->Store(key, result.data, width, height);
+        }
+        context.Trim();
         return result;
     }
     
+    // PNG 尚无解码器，原样返回
     ThumbnailResult GeneratePngThumbnail(const std::string& path) {
-        return GenerateJpegThumbnail(path);
+        ThumbnailResult result;
+        result.path = path;
+        if (layout_ != PixelLayout::Rgb) {
+            result.success = false;
+            result.cached = false;
+            result.width = 0;
+            result.height = 0;
+            result.error = "Pixel output supports JPEG only";
+            return result;
+        }
+        result.success = ReadWholeFile(path, result.data, result.error);
+        result.cached = false;
+        result.width = 0;
+        result.height = 0;
+        // 实际尺寸取 IHDR：签名 8 字节后紧跟长度与 "IHDR"，再是大端宽高
+        const std::vector<uint8_t>& d = result.data;
+        if (result.success && d.size() >= 24 && memcmp(d.data() + 12, "IHDR", 4) == 0) {
+            result.width = int(uint32_t(d[16]) << 24 | uint32_t(d[17]) << 16 | uint32_t(d[18]) << 8 | d[19]);
+            result.height = int(uint32_t(d[20]) << 24 | uint32_t(d[21]) << 16 | uint32_t(d[22]) << 8 | d[23]);
+        }
+        return result;
+    }
+    
+    static const char* FormatName(PixelLayout layout) {
+        switch (layout) {
+            case PixelLayout::Rgba: return "rgba";
+            case PixelLayout::Bgra: return "bgra";
+            default: return "jpeg";
+        }
+    }
+    
+    static bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& data, std::string& error) {
+        FileSource source;
+        if (!source.Open(path, false)) {
+            error = "Cannot open file";
+            return false;
+        }
+        return ReadWholeFile(source, data, error);
+    }
+    
+    static bool ReadWholeFile(const FileSource& source, std::vector<uint8_t>& data, std::string& error) {
+        data.resize(static_cast<size_t>(source.Size()));
+        if (!source.Read(0, data.data(), data.size())) {
+            data.clear();
+            error = "Failed to read file";
+            return false;
+        }
+        return true;
     }
 };
 
@@ -166,15 +279,34 @@ Napi::Value GenerateThumbnails(const Napi::CallbackInfo& info) {
     int maxWidth = 120;
     int maxHeight = 80;
     int quality = 85;
+    PixelLayout layout = PixelLayout::Rgb;
+    bool parallel = true;
+    std::string cacheDir;
+    uint64_t cacheBytes = 512ull * 1024 * 1024;
     
     if (info.Length() > 1 && info[1].IsObject()) {
         Napi::Object options = info[1].As<Napi::Object>();
         if (options.Has("maxWidth")) maxWidth = options.Get("maxWidth").As<Napi::Number>().Int32Value();
         if (options.Has("maxHeight")) maxHeight = options.Get("maxHeight").As<Napi::Number>().Int32Value();
         if (options.Has("quality")) quality = options.Get("quality").As<Napi::Number>().Int32Value();
+        if (options.Has("format")) {
+            std::string format = options.Get("format").As<Napi::String>().Utf8Value();
+            if (format == "rgba") {
+                layout = PixelLayout::Rgba;
+            } else if (format == "bgra") {
+                layout = PixelLayout::Bgra;
+            } else if (format != "jpeg") {
+                Napi::TypeError::New(env, "format must be 'jpeg', 'rgba' or 'bgra'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+        }
+        if (options.Has("parallel")) parallel = options.Get("parallel").As<Napi::Boolean>().Value();
+        if (options.Has("cacheDir")) cacheDir = options.Get("cacheDir").As<Napi::String>().Utf8Value();
+        if (options.Has("cacheBytes")) cacheBytes = static_cast<uint64_t>(options.Get("cacheBytes").As<Napi::Number>().DoubleValue());
     }
     
-    ThumbnailGenerator* worker = new ThumbnailGenerator(env, paths, maxWidth, maxHeight, quality);
+    ThumbnailGenerator* worker = new ThumbnailGenerator(env, paths, maxWidth, maxHeight, quality, layout, parallel,
+                                                        cacheDir, cacheBytes);
     worker->Queue();
     return worker->GetPromise();
 }
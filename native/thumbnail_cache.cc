@@ -0,0 +1,523 @@
+#include "thumbnail_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "work_pool.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kPackMagic[4] = {'Q', 'P', 'T', 'P'};
+const char kIndexMagic[4] = {'Q', 'P', 'T', 'I'};
+const uint32_t kIndexVersion = 1;
+const uint64_t kPackHeaderSize = 8;                     // 魔数 + 代号
+const uint32_t kMaxThumbnailBytes = 16 * 1024 * 1024;
+const uint64_t kCompactSlack = 8 * 1024 * 1024;         // 失效数据少于此量时不值得压实
+
+#ifdef _WIN32
+std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(size - 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
+    return result;
+}
+#endif
+
+FILE* OpenFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    return _wfopen(Utf8ToWide(path).c_str(), Utf8ToWide(mode).c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+void RemoveFile(const std::string& path) {
+#ifdef _WIN32
+    DeleteFileW(Utf8ToWide(path).c_str());
+#else
+    unlink(path.c_str());
+#endif
+}
+
+bool MoveOver(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExW(Utf8ToWide(from).c_str(), Utf8ToWide(to).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool ReadAll(const std::string& path, std::vector<char>& data) {
+    FILE* file = OpenFile(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(fileSize > 0 ? fileSize : 0);
+    bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+// 64 位 FNV-1a，依次混入路径与生成参数
+uint64_t KeyHash(const ThumbnailCacheKey& key) {
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](const void* data, size_t length) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; i++) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    };
+    mix(key.path.data(), key.path.size());
+    int32_t params[4] = {key.maxWidth, key.maxHeight, key.quality, key.format};
+    mix(params, sizeof(params));
+    return h;
+}
+
+template <typename T>
+void Put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Take(const std::vector<char>& data, size_t& pos, T& value) {
+    if (data.size() - pos < sizeof(value)) return false;
+    memcpy(&value, data.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+std::string PackHeader(uint32_t generation) {
+    std::string header(kPackMagic, 4);
+    Put(header, generation);
+    return header;
+}
+
+std::string IndexHeader(uint32_t generation) {
+    std::string header(kIndexMagic, 4);
+    Put(header, kIndexVersion);
+    Put(header, generation);
+    return header;
+}
+
+// 先写临时文件再替换，避免中途退出留下半个文件
+bool WriteAtomically(const std::string& path, const std::string& data) {
+    std::string tmpPath = path + ".tmp";
+    FILE* file = OpenFile(tmpPath, "wb");
+    if (!file) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !MoveOver(tmpPath, path)) {
+        RemoveFile(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// pack 文件的只读映射，建立后长度固定；文件继续追加后由新映射接替。
+// 压实切换后被替换的 pack 在最后一个持有者释放映射时删除
+class ThumbnailCache::Mapping {
+public:
+    static std::shared_ptr<Mapping> Create(const std::string& path) {
+        std::shared_ptr<Mapping> mapping(new Mapping(path));
+#ifdef _WIN32
+        HANDLE file = CreateFileW(Utf8ToWide(path).c_str(), GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER size;
+        HANDLE section = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            section = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        CloseHandle(file);
+        if (!section) return nullptr;
+        mapping->data_ = static_cast<const uint8_t*>(MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(section);
+        if (!mapping->data_) return nullptr;
+        mapping->size_ = static_cast<uint64_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        mapping->data_ = static_cast<const uint8_t*>(data);
+        mapping->size_ = static_cast<uint64_t>(st.st_size);
+#endif
+        return mapping;
+    }
+
+    ~Mapping() {
+        if (data_) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+#endif
+        }
+        if (removeOnRelease_) RemoveFile(path_);
+    }
+
+    const uint8_t* Data() const { return data_; }
+    uint64_t Size() const { return size_; }
+    void RemoveOnRelease() { removeOnRelease_ = true; }
+
+private:
+    explicit Mapping(const std::string& path) : path_(path) {}
+
+    std::string path_;
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    bool removeOnRelease_ = false;
+};
+
+namespace {
+
+void AppendRecord(std::string& out, uint64_t hash, uint64_t size, double mtime, uint64_t offset,
+                  uint32_t length, int32_t width, int32_t height) {
+    Put(out, hash);
+    Put(out, size);
+    Put(out, mtime);
+    Put(out, offset);
+    Put(out, length);
+    Put(out, width);
+    Put(out, height);
+}
+
+} // namespace
+
+std::shared_ptr<ThumbnailCache> ThumbnailCache::Open(const std::string& directory, uint64_t budgetBytes) {
+    static std::mutex registryMutex;
+    static std::unordered_map<std::string, std::shared_ptr<ThumbnailCache>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = registry.find(directory);
+    if (it != registry.end()) {
+        std::lock_guard<std::mutex> cacheLock(it->second->mutex_);
+        it->second->budget_ = budgetBytes;
+        it->second->MaybeCompact();
+        return it->second;
+    }
+
+    std::shared_ptr<ThumbnailCache> cache(new ThumbnailCache(directory, budgetBytes));
+    cache->Load();
+    {
+        std::lock_guard<std::mutex> cacheLock(cache->mutex_);
+        cache->MaybeCompact();
+    }
+    registry.emplace(directory, cache);
+    return cache;
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    if (pack_) fclose(pack_);
+    if (index_) fclose(index_);
+}
+
+std::string ThumbnailCache::PackPath(int slot) const {
+    return directory_ + "/thumbs-" + std::to_string(slot) + ".pack";
+}
+
+std::string ThumbnailCache::IndexPath(int slot) const {
+    return directory_ + "/thumbs-" + std::to_string(slot) + ".idx";
+}
+
+bool ThumbnailCache::Lookup(const ThumbnailCacheKey& key, std::vector<uint8_t>& data, int& width, int& height) {
+    std::shared_ptr<Mapping> mapping;
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(KeyHash(key));
+        if (it == entries_.end() || it->second.size != key.size || it->second.mtime != key.mtime) return false;
+        it->second.lastUse = ++clock_;
+        entry = it->second;
+        mapping = MappingFor(entry.offset + entry.length);
+    }
+    if (!mapping) return false;
+
+    // 拷贝在锁外进行；映射由本地引用保活，压实切换不影响
+    data.assign(mapping->Data() + entry.offset, mapping->Data() + entry.offset + entry.length);
+    width = entry.width;
+    height = entry.height;
+    return true;
+}
+
+void ThumbnailCache::Store(const ThumbnailCacheKey& key, const std::vector<uint8_t>& data, int width, int height) {
+    if (data.empty() || data.size() > kMaxThumbnailBytes) return;
+    uint64_t hash = KeyHash(key);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pack_ || !index_) return;
+    auto it = entries_.find(hash);
+    if (it != entries_.end() && it->second.size == key.size && it->second.mtime == key.mtime) return;
+
+    // 先落数据再写索引：进程中途退出时，索引里指向 pack 末尾之外的记录在加载时丢弃
+    Entry entry = {key.size, key.mtime, packSize_, static_cast<uint32_t>(data.size()), width, height, ++clock_};
+    std::string record;
+    AppendRecord(record, hash, entry.size, entry.mtime, entry.offset, entry.length, entry.width, entry.height);
+    bool ok = fwrite(data.data(), 1, data.size(), pack_) == data.size() && fflush(pack_) == 0 &&
+              fwrite(record.data(), 1, record.size(), index_) == record.size() && fflush(index_) == 0;
+    if (!ok) {
+        // 写失败（磁盘满等）后 pack 末尾位置不再可信，本次会话内只读
+        fclose(pack_);
+        fclose(index_);
+        pack_ = nullptr;
+        index_ = nullptr;
+        return;
+    }
+
+    if (it != entries_.end()) {
+        liveBytes_ -= it->second.length;
+        it->second = entry;
+    } else {
+        entries_.emplace(hash, entry);
+    }
+    liveBytes_ += entry.length;
+    packSize_ += entry.length;
+    MaybeCompact();
+}
+
+size_t ThumbnailCache::Count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void ThumbnailCache::Load() {
+    // 取两组中索引有效且代号较大的一组
+    int slot = -1;
+    uint32_t generation = 0;
+    std::vector<char> index;
+    for (int s = 0; s < 2; s++) {
+        std::vector<char> data;
+        size_t pos = 4;
+        uint32_t version = 0, gen = 0;
+        if (!ReadAll(IndexPath(s), data) || data.size() < 12 || memcmp(data.data(), kIndexMagic, 4) != 0 ||
+            !Take(data, pos, version) || version != kIndexVersion || !Take(data, pos, gen)) {
+            continue;
+        }
+        if (slot < 0 || gen > generation) {
+            slot = s;
+            generation = gen;
+            index.swap(data);
+        }
+    }
+
+    // pack 头的代号必须与索引一致，否则是压实切换中途留下的文件
+    std::vector<char> packHeader;
+    uint64_t packSize = 0;
+    if (slot >= 0) {
+        FILE* pack = OpenFile(PackPath(slot), "rb");
+        if (pack) {
+            packHeader.resize(kPackHeaderSize);
+            if (fread(packHeader.data(), 1, packHeader.size(), pack) != packHeader.size()) packHeader.clear();
+            fseek(pack, 0, SEEK_END);
+            packSize = static_cast<uint64_t>(ftell(pack));
+            fclose(pack);
+        }
+        std::string expected = PackHeader(generation);
+        if (packHeader.size() != expected.size() || memcmp(packHeader.data(), expected.data(), expected.size()) != 0) {
+            slot = -1;
+        }
+    }
+
+    if (slot < 0) {
+        entries_.clear();
+        if (!CreateSlot(0, generation + 1)) return;
+        RemoveFile(PackPath(1));
+        RemoveFile(IndexPath(1));
+        return;
+    }
+
+    size_t pos = 12;
+    size_t records = 0;
+    size_t validEnd = pos;
+    while (pos < index.size()) {
+        uint64_t hash;
+        Entry entry;
+        if (!Take(index, pos, hash) || !Take(index, pos, entry.size) || !Take(index, pos, entry.mtime) ||
+            !Take(index, pos, entry.offset) || !Take(index, pos, entry.length) ||
+            !Take(index, pos, entry.width) || !Take(index, pos, entry.height)) {
+            break;
+        }
+        validEnd = pos;
+        records++;
+        if (entry.offset < kPackHeaderSize || entry.length > kMaxThumbnailBytes ||
+            entry.offset + entry.length > packSize) {
+            continue;
+        }
+        entry.lastUse = ++clock_;
+        entries_[hash] = entry;
+    }
+
+    for (const auto& entry : entries_) liveBytes_ += entry.second.length;
+    packSize_ = packSize;
+    generation_ = generation;
+    slot_ = slot;
+    RemoveFile(PackPath(slot ^ 1));
+    RemoveFile(IndexPath(slot ^ 1));
+    mapping_ = Mapping::Create(PackPath(slot));
+
+    // 末尾残缺的索引重写后才能继续追加，重写失败则本次只读；失效记录的清理交给压实
+    if (validEnd != index.size()) {
+        std::string buffer = IndexHeader(generation);
+        buffer.append(index.data() + 12, validEnd - 12);
+        if (!WriteAtomically(IndexPath(slot), buffer)) return;
+    }
+    pack_ = OpenFile(PackPath(slot), "ab");
+    index_ = OpenFile(IndexPath(slot), "ab");
+}
+
+bool ThumbnailCache::CreateSlot(int slot, uint32_t generation) {
+    if (!WriteAtomically(PackPath(slot), PackHeader(generation)) ||
+        !WriteAtomically(IndexPath(slot), IndexHeader(generation))) {
+        return false;
+    }
+    packSize_ = kPackHeaderSize;
+    liveBytes_ = 0;
+    generation_ = generation;
+    slot_ = slot;
+    pack_ = OpenFile(PackPath(slot), "ab");
+    index_ = OpenFile(IndexPath(slot), "ab");
+    return true;
+}
+
+// 调用方持锁。当前映射不覆盖 [0, end) 时按文件现有长度重新映射
+std::shared_ptr<ThumbnailCache::Mapping> ThumbnailCache::MappingFor(uint64_t end) {
+    if (!mapping_ || mapping_->Size() < end) {
+        if (pack_) fflush(pack_);
+        std::shared_ptr<Mapping> mapping = Mapping::Create(PackPath(slot_));
+        if (mapping) mapping_ = mapping;
+    }
+    return mapping_ && mapping_->Size() >= end ? mapping_ : nullptr;
+}
+
+// 调用方持锁
+void ThumbnailCache::MaybeCompact() {
+    if (compacting_ || !pack_ || !index_ || packSize_ < retryAfter_) return;
+    uint64_t dead = packSize_ - kPackHeaderSize - liveBytes_;
+    if (packSize_ <= budget_ + kCompactSlack && dead <= std::max(liveBytes_, kCompactSlack)) return;
+
+    compacting_ = true;
+    std::shared_ptr<ThumbnailCache> self = shared_from_this();
+    WorkStealingPool::Shared().Submit([self]() { self->Compact(); });
+}
+
+void ThumbnailCache::Compact() {
+    // 第一步（持锁）：取条目快照和覆盖它们的映射
+    std::vector<std::pair<uint64_t, Entry>> kept;
+    std::shared_ptr<Mapping> source;
+    uint64_t snapshotEnd, target;
+    uint32_t generation;
+    int slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        kept.assign(entries_.begin(), entries_.end());
+        source = MappingFor(packSize_);
+        snapshotEnd = packSize_;
+        target = budget_ / 4 * 3;
+        generation = generation_ + 1;
+        slot = slot_ ^ 1;
+        if (!source) {
+            retryAfter_ = packSize_ + kCompactSlack;
+            compacting_ = false;
+            return;
+        }
+    }
+
+    // 第二步（不持锁）：按最近使用从新到旧保留到预算的 3/4，再按从旧到新写入，
+    // 重新加载时记录顺序仍反映使用先后
+    std::sort(kept.begin(), kept.end(), [](const std::pair<uint64_t, Entry>& a, const std::pair<uint64_t, Entry>& b) {
+        return a.second.lastUse > b.second.lastUse;
+    });
+    uint64_t keptBytes = 0;
+    size_t count = 0;
+    while (count < kept.size() && keptBytes + kept[count].second.length <= target) {
+        keptBytes += kept[count++].second.length;
+    }
+    kept.resize(count);
+    std::reverse(kept.begin(), kept.end());
+
+    std::string packPath = PackPath(slot);
+    std::string indexPath = IndexPath(slot);
+    FILE* pack = OpenFile(packPath, "wb");
+    std::string header = PackHeader(generation);
+    bool ok = pack && fwrite(header.data(), 1, header.size(), pack) == header.size();
+
+    std::string index = IndexHeader(generation);
+    std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> moved;     // 键 → (旧位置, 新位置)
+    uint64_t offset = kPackHeaderSize;
+    for (size_t i = 0; ok && i < kept.size(); i++) {
+        const Entry& e = kept[i].second;
+        ok = fwrite(source->Data() + e.offset, 1, e.length, pack) == e.length;
+        AppendRecord(index, kept[i].first, e.size, e.mtime, offset, e.length, e.width, e.height);
+        moved[kept[i].first] = {e.offset, offset};
+        offset += e.length;
+    }
+
+    // 第三步（持锁）：补上压实期间新写入的条目，写出索引后切换到新的一组
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<Mapping> latest = ok ? MappingFor(packSize_) : nullptr;
+    std::unordered_map<uint64_t, Entry> next;
+    for (const auto& entry : entries_) {
+        Entry e = entry.second;
+        if (e.offset < snapshotEnd) {
+            // 快照之后未被覆盖且在保留范围内的条目直接换成新位置
+            auto it = moved.find(entry.first);
+            if (it == moved.end() || it->second.first != e.offset) continue;
+            e.offset = it->second.second;
+        } else if (ok && latest) {
+            ok = fwrite(latest->Data() + e.offset, 1, e.length, pack) == e.length;
+            e.offset = offset;
+            offset += e.length;
+            AppendRecord(index, entry.first, e.size, e.mtime, e.offset, e.length, e.width, e.height);
+        }
+        next.emplace(entry.first, e);
+    }
+
+    if (pack) ok = fclose(pack) == 0 && ok;
+    ok = ok && latest && WriteAtomically(indexPath, index);
+    if (!ok) {
+        // 失败（目录只读、旧文件仍被占用等）后等 pack 再增长一段才重试
+        RemoveFile(packPath);
+        retryAfter_ = packSize_ + kCompactSlack;
+        compacting_ = false;
+        return;
+    }
+
+    // 旧索引立即删除；旧 pack 可能仍被读取方映射，等最后一个映射释放时删除
+    if (pack_) fclose(pack_);
+    if (index_) fclose(index_);
+    RemoveFile(IndexPath(slot_));
+    mapping_->RemoveOnRelease();
+    mapping_.reset();
+
+    entries_.swap(next);
+    liveBytes_ = 0;
+    for (const auto& entry : entries_) liveBytes_ += entry.second.length;
+    packSize_ = offset;
+    generation_ = generation;
+    slot_ = slot;
+    pack_ = OpenFile(packPath, "ab");
+    index_ = OpenFile(indexPath, "ab");
+    mapping_ = Mapping::Create(packPath);
+    compacting_ = false;
+}
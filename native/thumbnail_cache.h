@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 缩略图的身份：源文件路径、大小、mtime 与生成参数，任一不同都视为不同的缩略图
+struct ThumbnailCacheKey {
+    std::string path;
+    uint64_t size = 0;
+    double mtime = 0;
+    int maxWidth = 0;
+    int maxHeight = 0;
+    int quality = 0;
+    int format = 0;     // 输出格式（PixelLayout）：JPEG 与原始像素分开缓存
+};
+
+// 持久缩略图缓存：每个缓存目录一份。编码好的缩略图只追加写入 pack 文件，
+// 索引日志记录 (键哈希, 大小, mtime) → pack 内的位置与尺寸；打开时 pack 整体 mmap，
+// 命中只是从映射拷贝几 KB，重新打开同一批图片时既不读原图也不解码。
+//
+// 两组文件（thumbs-0 / thumbs-1）交替使用，索引头里代号较大的一组有效。被覆盖的旧数据或
+// 总量超出预算时在共享线程池上压实：按最近使用保留到预算的 3/4 写入另一组文件再切换，
+// 期间读写照常进行，旧映射由最后一个使用者释放。
+class ThumbnailCache : public std::enable_shared_from_this<ThumbnailCache> {
+public:
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // 同一目录在进程内共享一个实例；目录需已存在。再次打开时以新的预算为准
+    static std::shared_ptr<ThumbnailCache> Open(const std::string& directory, uint64_t budgetBytes);
+
+    bool Lookup(const ThumbnailCacheKey& key, std::vector<uint8_t>& data, int& width, int& height);
+    void Store(const ThumbnailCacheKey& key, const std::vector<uint8_t>& data, int width, int height);
+
+    size_t Count() const;
+
+private:
+    struct Entry {
+        uint64_t size;
+        double mtime;
+        uint64_t offset;
+        uint32_t length;
+        int32_t width;
+        int32_t height;
+        uint64_t lastUse;     // 仅在内存中维护，加载时按记录顺序近似
+    };
+
+    class Mapping;
+
+    ThumbnailCache(const std::string& directory, uint64_t budgetBytes)
+        : directory_(directory), budget_(budgetBytes) {}
+
+    std::string PackPath(int slot) const;
+    std::string IndexPath(int slot) const;
+
+    void Load();
+    bool CreateSlot(int slot, uint32_t generation);
+    std::shared_ptr<Mapping> MappingFor(uint64_t end);
+    void MaybeCompact();
+    void Compact();
+
+    std::string directory_;
+    uint64_t budget_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::shared_ptr<Mapping> mapping_;
+    FILE* pack_ = nullptr;
+    FILE* index_ = nullptr;
+    uint64_t packSize_ = 0;
+    uint64_t liveBytes_ = 0;
+    uint64_t clock_ = 0;
+    uint32_t generation_ = 0;
+    int slot_ = 0;
+    bool compacting_ = false;
+    uint64_t retryAfter_ = 0;       // 压实失败后，pack 长到此长度前不再尝试
+};
@@ -12,16 +12,20 @@
 #include <condition_variable>
 #include <algorithm>
 
+#include "external_buffer.h"
+#include "image_formats.h"
+
 #pragma comment(lib, "windowscodecs.lib")
 
+// 扩展名均为 ASCII，窄化后直接查共享注册表
 static bool IsRawExtension(const std::wstring& ext) {
-    static const std::vector<std::wstring> rawExts = {
-        L".cr2", L".cr3", L".nef", L".arw", L".dng", L".raf",
-        L".orf", L".rw2", L".pef", L".srw", L".x3f", L".raw"
-    };
-    std::wstring lowerExt = ext;
-    std::transform(lowerExt.begin(), lowerExt.end(), lowerExt.begin(), ::towlower);
-    return std::find(rawExts.begin(), rawExts.end(), lowerExt) != rawExts.end();
+    std::string narrow;
+    narrow.reserve(ext.size());
+    for (wchar_t c : ext) {
+        if (c > 0x7F) return false;
+        narrow.push_back(static_cast<char>(c));
+    }
+    return IsRawFormat(FormatFromExtension(narrow));
 }
 
 static std::wstring GetExtension(const std::wstring& path) {
@@ -602,9 +606,7 @@ protected:
             obj.Set("needsBackgroundDecode", Napi::Boolean::New(env, needsBackgroundDecode_));
             
             if (!cacheItem_.data.empty()) {
-                Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                    env, cacheItem_.data.data(), cacheItem_.data.size());
-                obj.Set("data", buffer);
+                obj.Set("data", ExternalBuffer(env, std::move(cacheItem_.data)));
             }
         }
         
@@ -803,9 +805,7 @@ protected:
             obj.Set("height", Napi::Number::New(env, height_));
             
             if (!data_.empty()) {
-                Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                    env, data_.data(), data_.size());
-                obj.Set("data", buffer);
+                obj.Set("data", ExternalBuffer(env, std::move(data_)));
             }
         }
         
@@ -0,0 +1,167 @@
+#include "work_pool.h"
+
+#include <chrono>
+
+static thread_local WorkStealingPool* t_currentPool = nullptr;
+static thread_local size_t t_currentIndex = 0;
+
+unsigned WorkStealingPool::DefaultThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    if (n == 0) n = 4;
+    return n < 2 ? 2 : n;
+}
+
+WorkStealingPool& WorkStealingPool::Shared() {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount)
+    : queued_(0), nextQueue_(0), stopping_(false) {
+    if (threadCount == 0) threadCount = DefaultThreadCount();
+
+    queues_.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+
+    threads_.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    sleepCV_.notify_all();
+
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task, bool urgent) {
+    if (urgent) {
+        {
+            std::lock_guard<std::mutex> lock(urgent_.mutex);
+            urgent_.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            queued_++;
+        }
+        sleepCV_.notify_one();
+        return;
+    }
+
+    size_t index;
+    if (t_currentPool == this) {
+        index = t_currentIndex;
+    } else {
+        index = nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        queued_++;
+    }
+    sleepCV_.notify_one();
+}
+
+bool WorkStealingPool::PopUrgent(Task& task) {
+    std::lock_guard<std::mutex> lock(urgent_.mutex);
+    if (urgent_.tasks.empty()) return false;
+
+    task = std::move(urgent_.tasks.front());
+    urgent_.tasks.pop_front();
+    queued_--;
+    return true;
+}
+
+bool WorkStealingPool::PopLocal(size_t index, Task& task) {
+    Queue& q = *queues_[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    queued_--;
+    return true;
+}
+
+bool WorkStealingPool::Steal(size_t start, Task& task) {
+    size_t count = queues_.size();
+    for (size_t i = 0; i < count; i++) {
+        Queue& q = *queues_[(start + i) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingPool::RunOne() {
+    Task task;
+    bool found = PopUrgent(task);
+    if (!found) {
+        found = (t_currentPool == this)
+            ? (PopLocal(t_currentIndex, task) || Steal(t_currentIndex + 1, task))
+            : Steal(nextQueue_.load(std::memory_order_relaxed), task);
+    }
+    if (!found) return false;
+
+    task();
+    return true;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+    t_currentPool = this;
+    t_currentIndex = index;
+
+    while (true) {
+        Task task;
+        if (PopUrgent(task) || PopLocal(index, task) || Steal(index + 1, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCV_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0) break;
+    }
+
+    t_currentPool = nullptr;
+}
+
+void TaskGroup::Run(std::function<void()> fn) {
+    pending_++;
+    pool_.Submit([this, fn = std::move(fn)]() {
+        fn();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) cv_.notify_all();
+    }, urgent_);
+}
+
+void TaskGroup::Wait() {
+    while (pending_ > 0) {
+        if (pool_.RunOne()) continue;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(2), [this] { return pending_ == 0; });
+    }
+
+    // 等最后一个任务离开临界区后再返回，避免组对象在其解锁前被析构
+    std::lock_guard<std::mutex> lock(mutex_);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，本线程提交的任务压入队尾并按 LIFO 执行，
+// 空闲线程从其他队列的队首窃取（FIFO），递归型任务（目录遍历等）能自然地在各核间摊开。
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // urgent 任务进入全局优先队列，所有工作线程先于各自队列取用
+    void Submit(Task task, bool urgent = false);
+
+    // 在调用线程上执行一个排队中的任务（若有），供等待方协助消化队列
+    bool RunOne();
+
+    unsigned Size() const { return static_cast<unsigned>(threads_.size()); }
+
+    static unsigned DefaultThreadCount();
+    static WorkStealingPool& Shared();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool PopUrgent(Task& task);
+    bool PopLocal(size_t index, Task& task);
+    bool Steal(size_t start, Task& task);
+    void WorkerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    Queue urgent_;
+    std::vector<std::thread> threads_;
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCV_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> nextQueue_;
+    std::atomic<bool> stopping_;
+};
+
+// 一组相关任务的完成计数；任务内部可以继续向同一组追加子任务，Wait() 期间调用线程会协助执行
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& pool, bool urgent = false)
+        : pool_(pool), urgent_(urgent), pending_(0) {}
+    ~TaskGroup() { Wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void Run(std::function<void()> fn);
+    void Wait();
+
+private:
+    WorkStealingPool& pool_;
+    bool urgent_;
+    std::atomic<size_t> pending_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// 协作式取消标记：发起方调用 Cancel()，执行方在批次之间检查 IsCancelled() 后尽快收尾
+class CancelToken {
+public:
+    CancelToken() : cancelled_(false) {}
+
+    void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool IsCancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled_;
+};
@@ -3,6 +3,7 @@ const { contextBridge, ipcRenderer } = require('electron');
 contextBridge.exposeInMainWorld('electronAPI', {
   openDirectoryDialog: (options) => ipcRenderer.invoke('open-directory-dialog', options),
   saveDialog: (options) => ipcRenderer.invoke('save-dialog', options),
+  setLibraryRoots: (roots) => ipcRenderer.invoke('library:set-roots', roots),
   
   showMessageBox: (options) => ipcRenderer.invoke('show-message-box', options),
   
@@ -40,7 +41,32 @@ contextBridge.exposeInMainWorld('electronAPI', {
     getStatus: () => ipcRenderer.invoke('native:get-status'),
     generateThumbnails: (paths, options) => ipcRenderer.invoke('native:generate-thumbnails', { paths, options }),
     readExifRatings: (paths) => ipcRenderer.invoke('native:read-exif-ratings', { paths }),
-    scanFiles: (directories, extensions) => ipcRenderer.invoke('native:scan-files', { directories, extensions })
+    scanFiles: (directories, extensions, options) => ipcRenderer.invoke('native:scan-files', { directories, extensions, options }),
+    cancelScan: (group) => ipcRenderer.invoke('native:cancel-scan', { group }),
+    scanFilesStream: async (directories, extensions, options, onBatch) => {
+      const streamId = `${Date.now()}-${Math.random()}`;
+      const listener = (event, data) => {
+        if (data.streamId === streamId) onBatch(data.files);
+      };
+      ipcRenderer.on('native:scan-files-batch', listener);
+      try {
+        return await ipcRenderer.invoke('native:scan-files-stream', { streamId, directories, extensions, options });
+      } finally {
+        ipcRenderer.removeListener('native:scan-files-batch', listener);
+      }
+    },
+    getRawPreviews: async (paths, options, onResult) => {
+      const requestId = `${Date.now()}-${Math.random()}`;
+      const listener = (event, data) => {
+        if (data.requestId === requestId) onResult(data.result);
+      };
+      ipcRenderer.on('native:raw-preview-result', listener);
+      try {
+        return await ipcRenderer.invoke('native:get-raw-previews', { requestId, paths, options });
+      } finally {
+        ipcRenderer.removeListener('native:raw-preview-result', listener);
+      }
+    }
   },
   
   settings: {
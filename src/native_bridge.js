@@ -5,10 +5,16 @@ let nativeModule = null;
 try {
     nativeModule = require('../native/build/Release/quickpick_native.node');
     console.log('[Native] C++ native module loaded successfully');
+    if (!nativeModule.hasLibjpeg) {
+        console.warn('[Native] Built without libjpeg: thumbnails are passed through undecoded, pixel output uses sharp');
+    }
 } catch (e) {
     console.warn('[Native] Failed to load C++ native module, using fallback:', e.message);
 }
 
+const utf8Decoder = new TextDecoder('utf-8');
+const SCAN_FLAG_DIRECTORY = 1;
+
 class NativeBridge {
     constructor() {
         this.isNativeAvailable = !!nativeModule;
@@ -18,12 +24,16 @@ class NativeBridge {
         const defaultOptions = {
             maxWidth: 120,
             maxHeight: 80,
-            quality: 85
+            quality: 85,
+            format: 'jpeg',
+            parallel: true
         };
         
         const opts = { ...defaultOptions, ...options };
+        // 像素输出依赖 libjpeg-turbo 解码，未启用时交给 sharp
+        const nativeSupportsFormat = opts.format === 'jpeg' || (nativeModule && nativeModule.hasLibjpeg);
         
-        if (this.isNativeAvailable && nativeModule.generateThumbnails) {
+        if (this.isNativeAvailable && nativeModule.generateThumbnails && nativeSupportsFormat) {
             try {
                 const results = await nativeModule.generateThumbnails(imagePaths, opts);
                 return this.processThumbnailResults(results);
@@ -47,28 +57,129 @@ class NativeBridge {
         return this.fallbackReadExifRatings(imagePaths);
     }
     
-    async scanFiles(directories, extensions = []) {
+    async scanFiles(directories, extensions = [], options = {}) {
         if (this.isNativeAvailable && nativeModule.scanFiles) {
             try {
-                const result = await nativeModule.scanFiles(directories, extensions);
+                const result = await nativeModule.scanFiles(directories, extensions, options);
+                if (result.cancelled) {
+                    throw this.createScanCancelledError(options.group);
+                }
+                if (options.sort) {
+                    return { files: result.files, order: result.order, captureTime: result.captureTime };
+                }
                 return result.files;
             } catch (e) {
+                if (e.name === 'AbortError') throw e;
                 console.error('[Native] File scanning failed:', e);
             }
         }
         
-        return this.fallbackScanFiles(directories, extensions);
+        const files = await this.fallbackScanFiles(directories, extensions, options);
+        const output = options.columnar ? this.toScanColumns(files) : files;
+        if (options.sort) {
+            return { files: output, order: this.fallbackSortOrder(files, options.sort) };
+        }
+        return output;
+    }
+    
+    // 取消 group 中进行中的扫描；同组发起新扫描时旧扫描也会自动取消
+    cancelScan(group) {
+        if (this.isNativeAvailable && nativeModule.cancelScan) {
+            return nativeModule.cancelScan(group);
+        }
+        return false;
+    }
+    
+    createScanCancelledError(group) {
+        const error = new Error(`Scan cancelled${group ? ` (group: ${group})` : ''}`);
+        error.name = 'AbortError';
+        return error;
+    }
+    
+    // 列式结果按下标解码出单个文件对象，只在真正用到时才创建字符串
+    scanColumnsEntry(columns, index) {
+        const start = columns.pathOffsets[index];
+        const end = columns.pathOffsets[index + 1];
+        const entry = {
+            path: utf8Decoder.decode(columns.pathData.subarray(start, end)),
+            name: utf8Decoder.decode(columns.pathData.subarray(columns.nameOffsets[index], end)),
+            extension: columns.extensions[columns.extensionIds[index]],
+            isDirectory: (columns.flags[index] & SCAN_FLAG_DIRECTORY) !== 0,
+            size: columns.size[index]
+        };
+        if (columns.mtime) entry.mtime = columns.mtime[index];
+        return entry;
+    }
+    
+    async scanFilesStream(directories, extensions = [], options = {}, onBatch = () => {}) {
+        if (this.isNativeAvailable && nativeModule.scanFilesStream) {
+            try {
+                return await nativeModule.scanFilesStream(directories, extensions, options, onBatch);
+            } catch (e) {
+                console.error('[Native] Streaming scan failed:', e);
+            }
+        }
+        
+        const files = await this.fallbackScanFiles(directories, extensions, options);
+        if (files.length > 0) {
+            onBatch(options.columnar ? this.toScanColumns(files) : files);
+        }
+        return { total: files.length };
+    }
+    
+    async scanSnapshot(directories, extensions = [], snapshotPath, options = {}) {
+        if (this.isNativeAvailable && nativeModule.scanSnapshot) {
+            try {
+                return await nativeModule.scanSnapshot(directories, extensions, snapshotPath, options);
+            } catch (e) {
+                console.error('[Native] Snapshot scan failed:', e);
+            }
+        }
+        
+        const files = await this.fallbackScanFiles(directories, extensions, options);
+        return { full: true, added: files, modified: [], removed: [] };
+    }
+    
+    watchDirectories(directories, extensions = [], options = {}, onChange = () => {}) {
+        if (this.isNativeAvailable && nativeModule.watchDirectories) {
+            try {
+                const watchId = nativeModule.watchDirectories(directories, extensions, options, onChange);
+                return { close: () => nativeModule.unwatchDirectories(watchId) };
+            } catch (e) {
+                console.warn('[Native] Directory watch unavailable, using fs.watch:', e.message);
+            }
+        }
+        
+        return this.fallbackWatchDirectories(directories, extensions, options, onChange);
+    }
+    
+    async pairFiles(jpgPaths, rawPaths) {
+        if (this.isNativeAvailable && nativeModule.pairFiles) {
+            try {
+                return await nativeModule.pairFiles(jpgPaths, rawPaths);
+            } catch (e) {
+                console.error('[Native] File pairing failed:', e);
+            }
+        }
+        
+        return this.fallbackPairFiles(jpgPaths, rawPaths);
     }
     
-    async getRawPreview(filePath) {
+    // 预览/缩略图的 data 均为 Buffer，直接引用 native 侧分配的内存；需要 data URL 时由调用方在 IPC 边界编码。
+    // options.minEdge：取短边不小于 minEdge 的最小内嵌预览，省略时取最大的
+    // options.autoRotate：按 EXIF Orientation 在 DCT 域无损转正（需 libjpeg 构建），成功时 rotated 为 true
+    // options.index：预览偏移索引文件路径，按 (路径, 大小, mtime) 记住预览位置，命中时跳过容器解析
+    async getRawPreview(filePath, options = {}) {
         if (this.isNativeAvailable && nativeModule.getRawPreview) {
             try {
-                const result = await nativeModule.getRawPreview(filePath);
+                const result = await nativeModule.getRawPreview(filePath, options);
                 if (result.success && result.data) {
                     return {
-                        data: result.data.toString('base64'),
+                        data: result.data,
                         width: result.width,
-                        height: result.height
+                        height: result.height,
+                        orientation: result.orientation,
+                        rotated: result.rotated
                     };
                 }
             } catch (e) {
@@ -79,15 +190,17 @@ class NativeBridge {
         return null;
     }
     
-    getRawPreviewSync(filePath) {
+    getRawPreviewSync(filePath, options = {}) {
         if (this.isNativeAvailable && nativeModule.getRawPreviewSync) {
             try {
-                const result = nativeModule.getRawPreviewSync(filePath);
+                const result = nativeModule.getRawPreviewSync(filePath, options);
                 if (result.success && result.data) {
                     return {
-                        data: result.data.toString('base64'),
+                        data: result.data,
                         width: result.width,
-                        height: result.height
+                        height: result.height,
+                        orientation: result.orientation,
+                        rotated: result.rotated
                     };
                 }
             } catch (e) {
@@ -98,13 +211,60 @@ class NativeBridge {
         return null;
     }
     
+    // 批量提取：在专用线程池上并行处理，每完成一个调用一次 onResult({ index, path, success, width, height, orientation, rotated, data })，
+    // 结果按完成顺序到达；全部送达后 resolve { total, succeeded }
+    async getRawPreviews(filePaths, options = {}, onResult = () => {}) {
+        if (this.isNativeAvailable && nativeModule.getRawPreviews) {
+            try {
+                return await nativeModule.getRawPreviews(filePaths, options, onResult);
+            } catch (e) {
+                console.error('[Native] Batch RAW preview extraction failed:', e);
+            }
+        }
+        
+        return null;
+    }
+    
+    // 内嵌预览阶梯：[{ offset, length, width, height, orientation }]，按像素面积从小到大
+    async listRawPreviews(filePath) {
+        if (this.isNativeAvailable && nativeModule.listRawPreviews) {
+            try {
+                const result = await nativeModule.listRawPreviews(filePath);
+                if (result.success) {
+                    return { format: result.format, previews: result.previews };
+                }
+            } catch (e) {
+                console.error('[Native] RAW preview listing failed:', e);
+            }
+        }
+        
+        return null;
+    }
+    
+    // JPEG 缩放：缩放 IDCT 解码 + 面积/Lanczos-3 重采样 + 按 EXIF 转正后重新编码，不经过 sharp。
+    // 构建时未找到 libjpeg 则返回 null
+    async resizeJpeg(buffer, options = {}) {
+        if (this.isNativeAvailable && nativeModule.resizeJpeg && nativeModule.hasLibjpeg) {
+            try {
+                const result = await nativeModule.resizeJpeg(buffer, options);
+                if (result.success && result.data) {
+                    return { data: result.data, width: result.width, height: result.height };
+                }
+            } catch (e) {
+                console.error('[Native] JPEG resize failed:', e);
+            }
+        }
+        
+        return null;
+    }
+    
     async getWICPreview(filePath, maxSize = 2000) {
         if (this.isNativeAvailable && nativeModule.getWICPreview) {
             try {
                 const result = await nativeModule.getWICPreview(filePath, maxSize);
                 if (result.success && result.data) {
                     return {
-                        data: result.data.toString('base64'),
+                        data: result.data,
                         width: result.width,
                         height: result.height,
                         fromCache: result.fromCache,
@@ -125,7 +285,7 @@ class NativeBridge {
                 const result = await nativeModule.decodeRAWInBackground(filePath, maxSize);
                 if (result.success && result.data) {
                     return {
-                        data: result.data.toString('base64'),
+                        data: result.data,
                         width: result.width,
                         height: result.height
                     };
@@ -143,7 +303,7 @@ class NativeBridge {
                 const result = await nativeModule.getWICThumbnail(filePath, maxSize);
                 if (result.success && result.data) {
                     return {
-                        data: result.data.toString('base64'),
+                        data: result.data,
                         width: result.width,
                         height: result.height
                     };
@@ -213,7 +373,9 @@ class NativeBridge {
                 processed[item.path] = {
                     data: item.data,
                     width: item.width,
-                    height: item.height
+                    height: item.height,
+                    format: item.format || 'jpeg',
+                    cached: !!item.cached
                 };
             }
         }
@@ -231,17 +393,40 @@ class NativeBridge {
             
             const promises = batch.map(async (imagePath) => {
                 try {
-                    const buffer = await sharp(imagePath)
+                    const pipeline = sharp(imagePath)
                         .resize(options.maxWidth, options.maxHeight, {
                             fit: 'inside',
                             withoutEnlargement: true
-                        })
+                        });
+                    
+                    // 像素输出：RGBA 原样返回，BGRA 逐像素交换 R/B（JPEG 不透明，无需预乘）
+                    if (options.format === 'rgba' || options.format === 'bgra') {
+                        const { data, info } = await pipeline.rotate().ensureAlpha().raw().toBuffer({ resolveWithObject: true });
+                        if (options.format === 'bgra') {
+                            for (let p = 0; p < data.length; p += 4) {
+                                const r = data[p];
+                                data[p] = data[p + 2];
+                                data[p + 2] = r;
+                            }
+                        }
+                        return {
+                            path: imagePath,
+                            data: new Uint8ClampedArray(data.buffer, data.byteOffset, data.length),
+                            width: info.width,
+                            height: info.height,
+                            success: true
+                        };
+                    }
+                    
+                    const buffer = await pipeline
                         .jpeg({ quality: options.quality })
                         .toBuffer();
                     
                     return {
                         path: imagePath,
                         data: buffer,
+                        width: options.maxWidth,
+                        height: options.maxHeight,
                         success: true
                     };
                 } catch (e) {
@@ -259,8 +444,9 @@ class NativeBridge {
                 if (result.success) {
                     results[result.path] = {
                         data: result.data,
-                        width: options.maxWidth,
-                        height: options.maxHeight
+                        width: result.width,
+                        height: result.height,
+                        format: options.format || 'jpeg'
                     };
                 }
             });
@@ -309,39 +495,192 @@ class NativeBridge {
         return results;
     }
     
-    async fallbackScanFiles(directories, extensions) {
+    async fallbackScanFiles(directories, extensions, options = {}) {
         const fs = require('fs');
         const results = [];
+        const maxDepth = options.recursive ? (options.maxDepth ?? -1) : 0;
         
-        for (const dir of directories) {
+        const withStat = options.stat !== false;
+        
+        const scanDir = (dir, depth) => {
             try {
-                const files = fs.readdirSync(dir);
+                const entries = fs.readdirSync(dir, { withFileTypes: true });
                 
-                files.forEach(file => {
+                entries.forEach(entry => {
+                    const file = entry.name;
                     const filePath = path.join(dir, file);
-                    const stat = fs.statSync(filePath);
+                    const isDirectory = entry.isSymbolicLink()
+                        ? fs.statSync(filePath).isDirectory()
+                        : entry.isDirectory();
                     const ext = path.extname(file).toLowerCase();
                     
-                    if (!stat.isDirectory()) {
-                        if (extensions.length === 0 || extensions.includes(ext)) {
-                            results.push({
-                                path: filePath,
-                                name: file,
-                                extension: ext,
-                                isDirectory: false,
-                                size: stat.size
-                            });
+                    if (isDirectory) {
+                        if (maxDepth < 0 || depth < maxDepth) {
+                            scanDir(filePath, depth + 1);
                         }
+                    } else if (extensions.length === 0 || extensions.includes(ext)) {
+                        const stat = withStat ? fs.statSync(filePath) : null;
+                        const item = {
+                            path: filePath,
+                            name: file,
+                            extension: ext,
+                            isDirectory: false,
+                            size: stat ? stat.size : 0
+                        };
+                        if (stat) item.mtime = stat.mtimeMs;
+                        results.push(item);
                     }
                 });
             } catch (e) {
                 console.error(`Error scanning directory ${dir}:`, e);
             }
+        };
+        
+        for (const dir of directories) {
+            scanDir(dir, 0);
         }
         
         return results;
     }
     
+    toScanColumns(files) {
+        const encoder = new TextEncoder();
+        const encodedPaths = files.map(f => encoder.encode(f.path));
+        const totalBytes = encodedPaths.reduce((sum, bytes) => sum + bytes.length, 0);
+        
+        const columns = {
+            columnar: true,
+            count: files.length,
+            pathData: new Uint8Array(totalBytes),
+            pathOffsets: new Uint32Array(files.length + 1),
+            nameOffsets: new Uint32Array(files.length),
+            extensionIds: new Uint8Array(files.length),
+            extensions: [],
+            size: new Float64Array(files.length),
+            flags: new Uint8Array(files.length)
+        };
+        const withMtime = files.some(f => f.mtime !== undefined);
+        if (withMtime) columns.mtime = new Float64Array(files.length);
+        
+        const extensionIds = new Map();
+        let offset = 0;
+        files.forEach((file, i) => {
+            columns.pathData.set(encodedPaths[i], offset);
+            offset += encodedPaths[i].length;
+            columns.pathOffsets[i + 1] = offset;
+            columns.nameOffsets[i] = offset - encoder.encode(file.name).length;
+            
+            let id = extensionIds.get(file.extension);
+            if (id === undefined) {
+                id = Math.min(columns.extensions.length, 255);
+                if (id < 255) {
+                    extensionIds.set(file.extension, id);
+                    columns.extensions.push(file.extension);
+                } else if (columns.extensions.length === 255) {
+                    columns.extensions.push('');
+                }
+            }
+            columns.extensionIds[i] = id;
+            columns.size[i] = file.size;
+            columns.flags[i] = file.isDirectory ? SCAN_FLAG_DIRECTORY : 0;
+            if (withMtime) columns.mtime[i] = file.mtime || 0;
+        });
+        
+        return columns;
+    }
+    
+    // 拍摄时间在 JS 回退路径下取 mtime
+    fallbackSortOrder(files, sort) {
+        const collator = new Intl.Collator(undefined, { numeric: true, sensitivity: 'base' });
+        const keys = Array.isArray(sort) ? sort : [sort];
+        const order = {};
+        
+        keys.forEach(key => {
+            const index = Uint32Array.from(files.keys());
+            const compare = {
+                name: (a, b) => collator.compare(files[a].name, files[b].name),
+                mtime: (a, b) => (files[a].mtime || 0) - (files[b].mtime || 0),
+                size: (a, b) => files[a].size - files[b].size,
+                captureTime: (a, b) => (files[a].mtime || 0) - (files[b].mtime || 0)
+            }[key];
+            if (!compare) throw new TypeError(`Unknown sort key: ${key}`);
+            order[key] = index.sort((a, b) => compare(a, b) || a - b);
+        });
+        
+        return order;
+    }
+    
+    fallbackPairFiles(jpgPaths, rawPaths) {
+        const stemKey = (p) => path.basename(p).replace(/\.[^/.]+$/, '').toLowerCase();
+        const buckets = new Map();
+        const bucketFor = (key) => {
+            let bucket = buckets.get(key);
+            if (!bucket) {
+                bucket = { jpg: [], raw: [] };
+                buckets.set(key, bucket);
+            }
+            return bucket;
+        };
+        
+        jpgPaths.forEach((p, i) => bucketFor(stemKey(p)).jpg.push(i));
+        rawPaths.forEach((p, i) => bucketFor(stemKey(p)).raw.push(i));
+        
+        const jpg = [];
+        const raw = [];
+        const jpgOrphans = [];
+        const rawOrphans = [];
+        let paired = 0;
+        
+        buckets.forEach(bucket => {
+            const n = Math.max(bucket.jpg.length, bucket.raw.length);
+            for (let k = 0; k < n; k++) {
+                const j = k < bucket.jpg.length ? bucket.jpg[k] : -1;
+                const r = k < bucket.raw.length ? bucket.raw[k] : -1;
+                jpg.push(j);
+                raw.push(r);
+                if (j >= 0 && r >= 0) paired++;
+                else if (j >= 0) jpgOrphans.push(j);
+                else rawOrphans.push(r);
+            }
+        });
+        
+        return {
+            jpg: Int32Array.from(jpg),
+            raw: Int32Array.from(raw),
+            jpgOrphans: Uint32Array.from(jpgOrphans),
+            rawOrphans: Uint32Array.from(rawOrphans),
+            paired
+        };
+    }
+    
+    fallbackWatchDirectories(directories, extensions, options, onChange) {
+        const fs = require('fs');
+        const watchers = directories.map(dir => fs.watch(dir, { recursive: !!options.recursive }, (eventType, filename) => {
+            if (!filename) return;
+            const ext = path.extname(filename).toLowerCase();
+            if (extensions.length > 0 && !extensions.includes(ext)) return;
+            
+            const filePath = path.join(dir, filename);
+            fs.stat(filePath, (err, stat) => {
+                if (err) {
+                    onChange([{ type: 'removed', path: filePath, name: path.basename(filename) }]);
+                } else if (stat.isFile()) {
+                    onChange([{
+                        type: eventType === 'rename' ? 'added' : 'modified',
+                        path: filePath,
+                        name: path.basename(filename),
+                        extension: ext,
+                        isDirectory: false,
+                        size: stat.size,
+                        mtime: stat.mtimeMs
+                    }]);
+                }
+            });
+        }));
+        
+        return { close: () => watchers.forEach(w => w.close()) };
+    }
+    
     getStatus() {
         return {
             nativeAvailable: this.isNativeAvailable,
@@ -52,6 +52,13 @@ class VirtualScroller {
         this.render();
     }
     
+    appendItems(items) {
+        if (!items.length) return;
+        this.items.push(...items);
+        this.updateTotalSize();
+        this.render();
+    }
+    
     updateTotalSize() {
         const totalItems = this.items.length;
         const totalRows = Math.ceil(totalItems / this.itemsPerRow);